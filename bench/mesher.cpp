@@ -0,0 +1,87 @@
+// Mesh build times for every MeshMode over a few representative chunks. The
+// iterations run in batches and the fastest batch counts, so a busy or
+// shared machine shows up less in the numbers.
+// Usage: ./bench_mesher [iterations]
+
+#include <glm/glm.hpp>
+
+#include "../lib/chunk.h"
+#include "../lib/mesher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+struct Case {
+	std::string Name;
+	Chunk C;
+};
+
+// the height pyramid main.cpp renders
+void fill_pyramid(Chunk &chunk) {
+	int height[16][16];
+	for (int i = 0; i < 16; i++)
+		for (int j = 0; j < 16; j++)
+			height[i][j] = 15 - abs(8-i) - abs(8-j);
+	chunk = Chunk(height);
+}
+
+// same shape, but with a handful of block types so greedy merging has work to do
+void fill_layers(Chunk &chunk) {
+	fill_pyramid(chunk);
+	const BlockID types[3] = { BLOCK_STONE, BLOCK_DIRT, BLOCK_GRASS };
+	for (int x = 0; x < 16; x++)
+		for (int y = 0; y < 16; y++)
+			for (int z = 0; z < 16; z++)
+				if (not chunk.IsAir(x, y, z))
+					chunk.SetCube(x, y, z, types[y * 3 / 16]);
+}
+
+// worst case for merging: half the cubes solid, at random
+void fill_noise(Chunk &chunk) {
+	unsigned int seed = 12345;
+	for (int x = 0; x < 16; x++) {
+		for (int y = 0; y < 16; y++) {
+			for (int z = 0; z < 16; z++) {
+				seed = seed * 1664525u + 1013904223u;
+				if (seed >> 31)
+					chunk.SetCube(x, y, z, BLOCK_STONE);
+				else
+					chunk.SetCube(x, y, z, BLOCK_AIR);
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	int iterations = argc > 1 ? atoi(argv[1]) : 1000;
+
+	static Case cases[3];
+	cases[0].Name = "pyramid"; fill_pyramid(cases[0].C);
+	cases[1].Name = "layers";  fill_layers(cases[1].C);
+	cases[2].Name = "noise";   fill_noise(cases[2].C);
+
+	printf("%-8s %-7s %10s %12s\n", "chunk", "mode", "vertices", "us/chunk");
+	for (Case &c : cases) {
+		MeshInput input(c.C);
+		for (int m = 0; m < MESH_MODE_COUNT; m++) {
+			MeshMode mode = (MeshMode)m;
+			size_t vertices = 0;
+			double us = 1e9;
+
+			const int BATCH = 10;
+			for (int done = 0; done < iterations; done += BATCH) {
+				auto start = std::chrono::steady_clock::now();
+				for (int i = 0; i < BATCH; i++)
+					vertices = mesh_chunk(input, mode).Vertices.size();
+				auto end = std::chrono::steady_clock::now();
+				us = std::min(us, std::chrono::duration<double, std::micro>(end - start).count() / BATCH);
+			}
+
+			printf("%-8s %-7s %10zu %12.2f\n", c.Name.c_str(), mesh_mode_name(mode), vertices, us);
+		}
+	}
+	return 0;
+}
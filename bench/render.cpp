@@ -0,0 +1,243 @@
+// Headless frame benchmark: renders a fixed world offscreen while the camera
+// circles it, then reports frame time percentiles and what was drawn. Needs
+// no display or GPU; a surfaceless EGL context works on Mesa's llvmpipe, and
+// a hidden GLFW window is tried when EGL isn't available.
+// Usage: ./bench_render [--frames N] [--width W] [--height H] [--world N]
+//                       [--mode culled|greedy|binary] [--instanced] [--no-occlusion]
+// Run from the repository root, like the game, so shader/ and textures/ resolve.
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../lib/camera.h"
+#include "../lib/shader.h"
+#include "../lib/blocktextures.h"
+#include "../lib/blockcolors.h"
+#include "../lib/camerauniforms.h"
+#include "../lib/chunk.h"
+#include "../lib/world.h"
+#include "../lib/worldrenderer.h"
+#include "../lib/profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Surfaceless context on the default EGL device, rendering only to FBOs
+bool create_egl_context() {
+	auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (not getPlatformDisplay)
+		return false;
+	EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY or not eglInitialize(display, &major, &minor))
+		return false;
+
+	eglBindAPI(EGL_OPENGL_API);
+	const EGLint attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE,
+	};
+	EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+	if (context == EGL_NO_CONTEXT or not eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+		return false;
+
+	return gladLoadGLLoader((GLADloadproc)eglGetProcAddress);
+}
+
+bool create_glfw_context() {
+	if (not glfwInit())
+		return false;
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow *window = glfwCreateWindow(64, 64, "bench_render", NULL, NULL);
+	if (not window)
+		return false;
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0);
+	return gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+}
+
+// value below which a fraction q of the sorted samples lie
+float percentile(const std::vector<float> &sorted, float q) {
+	size_t i = std::min(sorted.size() - 1, (size_t)(q * sorted.size()));
+	return sorted[i];
+}
+
+int main(int argc, char **argv) {
+	PROFILE_THREAD("main");
+	int frames = 600, width = 1280, height = 720, worldSize = 8;
+	MeshMode mode = MESH_BINARY;
+	RenderPath path = RENDER_MESHES;
+	bool occlusion = true;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--frames" and hasValue)
+			frames = std::max(1, atoi(argv[++i]));
+		else if (arg == "--width" and hasValue)
+			width = atoi(argv[++i]);
+		else if (arg == "--height" and hasValue)
+			height = atoi(argv[++i]);
+		else if (arg == "--world" and hasValue)
+			worldSize = std::max(1, atoi(argv[++i]));
+		else if (arg == "--mode" and hasValue) {
+			std::string name = argv[++i];
+			for (int m = 0; m < MESH_MODE_COUNT; m++)
+				if (name == mesh_mode_name((MeshMode)m))
+					mode = (MeshMode)m;
+		} else if (arg == "--instanced")
+			path = RENDER_INSTANCED;
+		else if (arg == "--no-occlusion")
+			occlusion = false;
+		else {
+			fprintf(stderr, "unknown argument %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (not create_egl_context() and not create_glfw_context()) {
+		print_failure("Failed to create an OpenGL context");
+		return 1;
+	}
+	print_message(std::string("rendering on ") + (const char *)glGetString(GL_RENDERER)
+			+ ", " + (const char *)glGetString(GL_VERSION));
+
+	// offscreen target, the same for both kinds of context
+	unsigned int fbo, color, depth;
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glGenRenderbuffers(1, &color);
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		print_failure("Offscreen framebuffer is incomplete");
+		return 1;
+	}
+
+	glViewport(0, 0, width, height);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+
+	BlockTextures blockTextures(block_registry());
+	blockTextures.bind(GL_TEXTURE0);
+	BlockColors blockColors(block_registry(), blockTextures.Layers);
+	blockColors.bind(GL_TEXTURE1);
+
+	Shader shader("shader/shader.vert", "shader/shader.frag");
+	shader.use();
+	shader.setInt("blockTextures", 0);
+	shader.setInt("blockColors", 1);
+	Shader instancedShader("shader/instanced.vert", "shader/shader.frag");
+	instancedShader.use();
+	instancedShader.setInt("blockTextures", 0);
+
+	CameraUniforms cameraUniforms;
+	cameraUniforms.Attach(shader);
+	cameraUniforms.Attach(instancedShader);
+	Shader &active = path == RENDER_INSTANCED ? instancedShader : shader;
+	active.use();
+
+	// main's pyramids on stone, worldSize chunks across
+	int pyramid[16][16];
+	for (int i = 0; i < 16; i++)
+		for (int j = 0; j < 16; j++)
+			pyramid[i][j] = 15 - abs(8-i) - abs(8-j);
+
+	World world;
+	for (int cx = -worldSize / 2; cx < worldSize - worldSize / 2; cx++) {
+		for (int cz = -worldSize / 2; cz < worldSize - worldSize / 2; cz++) {
+			world.SetChunk(cx, 0, cz, Chunk(pyramid));
+			world.CreateChunk(cx, -1, cz, BLOCK_STONE);
+		}
+	}
+
+	// mesh everything up front so the timed frames only draw
+	ThreadPool workers;
+	WorldRenderer renderer(workers);
+	renderer.OcclusionCulling = occlusion;
+	auto meshStart = std::chrono::steady_clock::now();
+	renderer.Update(world, mode, path);
+	while (renderer.Pending > 0)
+		renderer.Update(world, mode, path);
+	auto meshEnd = std::chrono::steady_clock::now();
+
+	glm::mat4 projection = glm::perspective(glm::radians(FOV), (float)width / (float)height, 0.1f, 100.0f);
+	float radius = worldSize * CHUNK_SIZE * 0.6f;
+
+	std::vector<float> frameMs, submitMs;
+	long long drawCalls = 0, triangles = 0;
+	for (int frame = 0; frame < frames; frame++) {
+		// one lap around the middle of the world, looking in at it from
+		// a few cubes above the pyramids (render y points down)
+		float angle = 2.0f * M_PI * frame / frames;
+		glm::vec3 position(radius * cosf(angle), -24.0f, radius * sinf(angle));
+		float yaw = glm::degrees(atan2f(-position.z, -position.x));
+		Camera camera(position, glm::vec3(0.0f, 1.0f, 0.0f), yaw, 25.0f);
+
+		PROFILE_ZONE("frame");
+		auto start = std::chrono::steady_clock::now();
+
+		glClearColor(0.2f, 0.3f, 0.6f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		glm::mat4 view = camera.GetViewMatrix();
+		cameraUniforms.Update(view, projection);
+		renderer.Update(world, mode, path);
+		renderer.Draw(active, projection * view, camera.Position);
+		auto submitted = std::chrono::steady_clock::now();
+
+		// wait for the frame to be done, as a swap would
+		glFinish();
+		auto end = std::chrono::steady_clock::now();
+
+		submitMs.push_back(std::chrono::duration<float, std::milli>(submitted - start).count());
+		frameMs.push_back(std::chrono::duration<float, std::milli>(end - start).count());
+		drawCalls += renderer.Stats.DrawCalls;
+		triangles += renderer.Stats.Triangles;
+	}
+
+	std::sort(frameMs.begin(), frameMs.end());
+	std::sort(submitMs.begin(), submitMs.end());
+	float total = 0.0f;
+	for (float ms : frameMs)
+		total += ms;
+
+	printf("%d frames at %dx%d, %d chunks (%s%s), meshed in %.1fms\n", frames, width, height,
+			(int)world.Chunks.Size(), path == RENDER_INSTANCED ? "instanced" : mesh_mode_name(mode),
+			occlusion ? "" : ", no occlusion culling",
+			std::chrono::duration<float, std::milli>(meshEnd - meshStart).count());
+	printf("%-8s %8s %8s %8s %8s %8s\n", "ms", "mean", "p50", "p90", "p99", "max");
+	printf("%-8s %8.3f %8.3f %8.3f %8.3f %8.3f\n", "frame", total / frames,
+			percentile(frameMs, 0.5f), percentile(frameMs, 0.9f), percentile(frameMs, 0.99f), frameMs.back());
+	printf("%-8s %8s %8.3f %8.3f %8.3f %8.3f\n", "submit", "",
+			percentile(submitMs, 0.5f), percentile(submitMs, 0.9f), percentile(submitMs, 0.99f), submitMs.back());
+	printf("per frame: %.1f draw calls, %.0f triangles\n", (double)drawCalls / frames, (double)triangles / frames);
+
+	// built with -DDUDUCRAFT_PROFILE, the zones of every frame
+	if (PROFILING)
+		profiler_write_trace("trace.json");
+
+	return 0;
+}
@@ -0,0 +1,110 @@
+// Terrain generation throughput on one core, with the noise vectorized and
+// forced scalar, and what the climate cache saves. Then the whole generator
+// on every core, with what its caches and queues hold afterwards.
+// Usage: ./bench_terrain [chunk columns]
+
+#include <glm/glm.hpp>
+
+#include "../lib/chunk.h"
+#include "../lib/terrain.h"
+#include "../lib/threadpool.h"
+#include "../lib/world.h"
+#include "../lib/worldgen.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char **argv) {
+	int columns = argc > 1 ? atoi(argv[1]) : 4096;
+	int side = 1;
+	while (side * side < columns)
+		side++;
+
+	TerrainGenerator terrain(1337);
+	printf("%-8s %14s %14s %14s %14s %14s\n", "noise", "us/heightmap", "columns/s", "us/chunk",
+			"us/miss", "us/hit");
+	for (int simd = 0; simd < 2; simd++) {
+		if (simd and not noise_avx2_supported()) {
+			printf("%-8s %14s\n", "avx2", "unsupported");
+			continue;
+		}
+		terrain.UseSIMD(simd);
+
+		// keeps the work from being optimized away, and should match
+		long long checksum = 0;
+		int height[CHUNK_SIZE][CHUNK_SIZE];
+		auto start = std::chrono::steady_clock::now();
+		for (int c = 0; c < columns; c++) {
+			terrain.Heightmap(c % side, c / side, height);
+			checksum += height[c % CHUNK_SIZE][c / CHUNK_SIZE % CHUNK_SIZE];
+		}
+		auto end = std::chrono::steady_clock::now();
+		double heightmapUs = std::chrono::duration<double, std::micro>(end - start).count() / columns;
+
+		// whole chunks, filling the blocks too
+		int chunks = columns / 16 + 1;
+		start = std::chrono::steady_clock::now();
+		for (int c = 0; c < chunks; c++)
+			checksum += terrain.Generate(c % side, 0, c / side).GetBlock(c % CHUNK_SIZE, 8, 0);
+		end = std::chrono::steady_clock::now();
+		double chunkUs = std::chrono::duration<double, std::micro>(end - start).count() / chunks;
+
+		// a chunk's climate where its region has to be computed, then for
+		// every chunk of the same regions once they're cached
+		ClimateMap climate(1337);
+		climate.Temperature.SIMD = climate.Humidity.SIMD = simd;
+		int regions = std::min<int>(columns / (CLIMATE_REGION * CLIMATE_REGION) + 1, CLIMATE_CACHE_REGIONS);
+		ChunkClimate columnClimate;
+		start = std::chrono::steady_clock::now();
+		for (int r = 0; r < regions; r++) {
+			climate.Columns(r * CLIMATE_REGION, 0, columnClimate);
+			checksum += columnClimate[0][0].Temperature * 1000.0f;
+		}
+		end = std::chrono::steady_clock::now();
+		double missUs = std::chrono::duration<double, std::micro>(end - start).count() / regions;
+
+		int hits = regions * CLIMATE_REGION * CLIMATE_REGION;
+		start = std::chrono::steady_clock::now();
+		for (int c = 0; c < hits; c++) {
+			climate.Columns(c / CLIMATE_REGION, c % CLIMATE_REGION, columnClimate);
+			checksum += columnClimate[c % CHUNK_SIZE][0].Humidity * 1000.0f;
+		}
+		end = std::chrono::steady_clock::now();
+		double hitUs = std::chrono::duration<double, std::micro>(end - start).count() / hits;
+
+		uint64_t computed, cacheHits;
+		climate.Stats(computed, cacheHits);
+		printf("%-8s %14.2f %14.0f %14.2f %14.2f %14.2f  (checksum %lld, %llu regions computed, %llu hits)\n",
+				simd ? "avx2" : "scalar", heightmapUs, 1e6 / heightmapUs, chunkUs, missUs, hitUs, checksum,
+				(unsigned long long)computed, (unsigned long long)cacheHits);
+	}
+
+	// every stage, on the shared pool, of the columns nearest the origin
+	// from y -1 to 1 like the game
+	ThreadPool workers;
+	World world;
+	WorldGenerator generator(1337, workers);
+	int radius = std::max(1, side / 4);
+	auto start = std::chrono::steady_clock::now();
+	for (int cx = -radius; cx < radius; cx++)
+		for (int cz = -radius; cz < radius; cz++)
+			for (int cy = 1; cy >= -1; cy--)
+				generator.Request(cx, cy, cz);
+	// submits, waits for every job, then collects, so no polling
+	// interval ends up in the time
+	while (generator.Pending() > 0) {
+		generator.Update(world);
+		workers.Wait();
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	uint64_t computed, cacheHits;
+	generator.Terrain.Climate.Stats(computed, cacheHits);
+	printf("\nworldgen %zu chunks on %d threads in %.1fms, %zu blocks queued for ungenerated chunks, %zu dropped\n",
+			world.Chunks.Size(), workers.Threads(), std::chrono::duration<double, std::milli>(end - start).count(),
+			generator.QueuedWrites(), generator.DroppedWrites());
+	printf("climate  %llu regions computed, %llu lookups from the cache\n",
+			(unsigned long long)computed, (unsigned long long)cacheHits);
+	return 0;
+}
@@ -1,3 +1,6 @@
 #!/bin/bash
 
 g++ -o out main.cpp glad.c -lglfw -lGL -lm -lXrandr -lX11 -lpthread -ldl
+g++ -O2 -o bench_mesher bench/mesher.cpp
+g++ -O2 -o bench_render bench/render.cpp glad.c -lEGL -lglfw -lGL -lm -lpthread -ldl
+g++ -O2 -o bench_terrain bench/terrain.cpp -lpthread
@@ -3,24 +3,64 @@
 
 #include <glm/glm.hpp>
 
-class Block {
-public:
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Chunks only store a BlockID per cube, everything else about a block lives
+// in its BlockType in the registry
+typedef uint16_t BlockID;
+
+const BlockID BLOCK_AIR       = 0;
+const BlockID BLOCK_STONE     = 1;
+const BlockID BLOCK_DIRT      = 2;
+const BlockID BLOCK_GRASS     = 3;
+const BlockID BLOCK_LOG       = 4;
+const BlockID BLOCK_LEAVES    = 5;
+const BlockID BLOCK_SAND      = 6;
+const BlockID BLOCK_SNOW      = 7;
+const BlockID BLOCK_DRY_GRASS = 8;
+
+enum BlockFlags {
+	BLOCK_SOLID  = 1 << 0,
+	BLOCK_OPAQUE = 1 << 1,
+};
+
+struct BlockType {
+	std::string Name;
 	glm::vec3 Color;
+	std::string Texture;
+	unsigned int Flags;
+};
 
-	Block() {
-		setAir();
-	}
+class BlockRegistry {
+public:
+	std::vector<BlockType> Types;
 
-	Block(glm::vec3 color) {
-		Color = color;
+	BlockRegistry() {
+		Register({"air",       {0.0f, 0.0f, 0.0f},   "",                  0});
+		Register({"stone",     {0.5f, 0.5f, 0.5f},   "",                  BLOCK_SOLID | BLOCK_OPAQUE});
+		Register({"dirt",      {0.5f, 0.3f, 0.1f},   "textures/dirt.jpg", BLOCK_SOLID | BLOCK_OPAQUE});
+		Register({"grass",     {0.3f, 0.7f, 0.2f},   "textures/dirt.jpg", BLOCK_SOLID | BLOCK_OPAQUE});
+		Register({"log",       {0.4f, 0.25f, 0.1f},  "",                  BLOCK_SOLID | BLOCK_OPAQUE});
+		Register({"leaves",    {0.2f, 0.5f, 0.1f},   "",                  BLOCK_SOLID | BLOCK_OPAQUE});
+		Register({"sand",      {0.85f, 0.8f, 0.55f}, "",                  BLOCK_SOLID | BLOCK_OPAQUE});
+		Register({"snow",      {0.95f, 0.95f, 1.0f}, "",                  BLOCK_SOLID | BLOCK_OPAQUE});
+		Register({"dry grass", {0.65f, 0.65f, 0.3f}, "textures/dirt.jpg", BLOCK_SOLID | BLOCK_OPAQUE});
 	}
 
-	void setAir()  { Color = {-1.0f, -1.0f, -1.0f}; }
-	void setFull() { Color = {1.0f, 1.0f, 1.0f};    }
-
-	bool IsAir() {
-		return Color == glm::vec3(-1.0f, -1.0f, -1.0f);
+	BlockID Register(BlockType type) {
+		Types.push_back(type);
+		return Types.size() - 1;
 	}
+
+	const BlockType& Get(BlockID id) const { return Types[id]; }
+	size_t Size() const { return Types.size(); }
 };
 
+BlockRegistry& block_registry() {
+	static BlockRegistry registry;
+	return registry;
+}
+
 #endif
@@ -0,0 +1,42 @@
+#ifndef BLOCKCOLORS_H
+#define BLOCKCOLORS_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include "block.h"
+
+// The registry's block colors as a buffer texture, indexed by BlockID, for
+// shaders that only get a block's ID per vertex (samplerBuffer blockColors).
+// The alpha channel holds the block's layer in BlockTextures, given layers.
+class BlockColors {
+public:
+	unsigned int Buffer, ID;
+
+	BlockColors(const BlockRegistry &registry, const std::vector<int> &layers = std::vector<int>()) {
+		std::vector<float> colors;
+		for (size_t id = 0; id < registry.Types.size(); id++) {
+			const BlockType &type = registry.Types[id];
+			colors.push_back(type.Color.x);
+			colors.push_back(type.Color.y);
+			colors.push_back(type.Color.z);
+			colors.push_back(id < layers.size() ? layers[id] : 0.0f);
+		}
+
+		glGenBuffers(1, &Buffer);
+		glBindBuffer(GL_TEXTURE_BUFFER, Buffer);
+		glBufferData(GL_TEXTURE_BUFFER, colors.size() * sizeof(float), colors.data(), GL_STATIC_DRAW);
+
+		glGenTextures(1, &ID);
+		glBindTexture(GL_TEXTURE_BUFFER, ID);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, Buffer);
+	}
+
+	void bind(GLenum texture) {
+		glActiveTexture(texture);
+		glBindTexture(GL_TEXTURE_BUFFER, ID);
+	}
+};
+
+#endif
@@ -0,0 +1,325 @@
+#ifndef BLOCKTEXTURES_H
+#define BLOCKTEXTURES_H
+
+#include <glad/glad.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "block.h"
+#include "dbgmsg.h"
+#include "image.h"
+#include "threadpool.h"
+
+const char *BLOCK_TEXTURE_CACHE = "textures/blocks.cache";
+
+// Scales an RGBA image to size x size, averaging the source pixels under
+// each target pixel (or repeating them, when growing)
+std::vector<unsigned char> resample_rgba(const unsigned char *pixels, int width, int height, int size) {
+	std::vector<unsigned char> out(size * size * 4);
+	for (int y = 0; y < size; y++) {
+		int y0 = y * height / size, y1 = std::max((y + 1) * height / size, y0 + 1);
+		for (int x = 0; x < size; x++) {
+			int x0 = x * width / size, x1 = std::max((x + 1) * width / size, x0 + 1);
+
+			int sum[4] = { 0, 0, 0, 0 };
+			for (int sy = y0; sy < y1; sy++)
+				for (int sx = x0; sx < x1; sx++)
+					for (int c = 0; c < 4; c++)
+						sum[c] += pixels[(sy * width + sx) * 4 + c];
+
+			int count = (x1 - x0) * (y1 - y0);
+			for (int c = 0; c < 4; c++)
+				out[(y * size + x) * 4 + c] = sum[c] / count;
+		}
+	}
+	return out;
+}
+
+// Every block texture in one GL_TEXTURE_2D_ARRAY, so all blocks draw with a
+// single bind (sampler2DArray blockTextures). Each texture file becomes one
+// layer of Size x Size with its own mipmaps. Layer 0 is plain white, for
+// blocks without a texture or whose texture failed to load.
+//
+// Files are decoded on a thread pool and the mip chains built on the CPU,
+// then everything is written to a cache file. As long as no texture file
+// changes, later runs map the cache and upload it without decoding anything.
+class BlockTextures {
+public:
+	unsigned int ID;
+	// a power of two
+	int Size;
+	int Levels;
+	int LayerCount;
+
+	// Layers[id] is the layer holding block id's texture
+	std::vector<int> Layers;
+
+	// whether the layers came out of the cache
+	bool Cached = false;
+
+	BlockTextures(const BlockRegistry &registry, int size = 64, std::string cachePath = BLOCK_TEXTURE_CACHE)
+			: Size(size) {
+		auto start = std::chrono::steady_clock::now();
+
+		Levels = 1;
+		while ((1 << (Levels - 1)) < size)
+			Levels++;
+
+		// distinct files, in order of first use
+		std::vector<std::string> files;
+		std::vector<int> fileOf;
+		for (const BlockType &type : registry.Types) {
+			if (type.Texture.empty()) {
+				fileOf.push_back(-1);
+				continue;
+			}
+			auto found = std::find(files.begin(), files.end(), type.Texture);
+			fileOf.push_back(found - files.begin());
+			if (found == files.end())
+				files.push_back(type.Texture);
+		}
+
+		glGenTextures(1, &ID);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+
+		std::vector<int> fileLayers;
+		Cached = loadCache(cachePath, files, fileLayers);
+		if (not Cached) {
+			std::vector<unsigned char> pixels = decode(files, fileLayers);
+			upload(pixels.data());
+			writeCache(cachePath, files, fileLayers, pixels);
+		}
+
+		for (int file : fileOf)
+			Layers.push_back(file < 0 ? 0 : fileLayers[file]);
+
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, Levels - 1);
+		// greedy quads repeat the texture once per cube
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		auto end = std::chrono::steady_clock::now();
+		print_success("Packed " + std::to_string(LayerCount) + " block texture layers of "
+				+ std::to_string(size) + "x" + std::to_string(size) + (Cached ? " from the cache" : "")
+				+ " in " + std::to_string(std::chrono::duration<float, std::milli>(end - start).count()) + "ms");
+	}
+
+	~BlockTextures() {
+		glDeleteTextures(1, &ID);
+	}
+
+	BlockTextures(const BlockTextures&) = delete;
+	BlockTextures& operator=(const BlockTextures&) = delete;
+
+	void bind(GLenum texture) {
+		glActiveTexture(texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+	}
+
+private:
+	static constexpr uint32_t CACHE_MAGIC = 0x31544344; // "DCT1"
+
+	// what a cached texture file looked like when it was decoded
+	struct FileStamp {
+		int64_t MTime = -1;
+		int64_t Bytes = -1;
+	};
+
+	static FileStamp stamp(const std::string &path) {
+		FileStamp s;
+		struct stat st;
+		if (stat(path.c_str(), &st) == 0) {
+			s.MTime = st.st_mtime;
+			s.Bytes = st.st_size;
+		}
+		return s;
+	}
+
+	// bytes of one layer at level, and of every layer at every level
+	size_t levelBytes(int level) const {
+		int dim = std::max(Size >> level, 1);
+		return (size_t)dim * dim * 4;
+	}
+
+	size_t pixelBytes() const {
+		return pixelBytes(LayerCount);
+	}
+
+	size_t pixelBytes(int layers) const {
+		size_t bytes = 0;
+		for (int level = 0; level < Levels; level++)
+			bytes += levelBytes(level) * layers;
+		return bytes;
+	}
+
+	// pixels holds every layer of level 0, then of level 1, ...
+	void upload(const unsigned char *pixels) {
+		for (int level = 0; level < Levels; level++) {
+			int dim = std::max(Size >> level, 1);
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, dim, dim, LayerCount, 0,
+					GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+			pixels += levelBytes(level) * LayerCount;
+		}
+	}
+
+	// Decodes and mips every file in parallel. Returns the pixels in the
+	// layout upload wants and sets the layer of each file.
+	std::vector<unsigned char> decode(const std::vector<std::string> &files, std::vector<int> &fileLayers) {
+		// mips[file][level], empty if the file didn't load
+		std::vector<std::vector<std::vector<unsigned char>>> mips(files.size());
+
+		stbi_set_flip_vertically_on_load(true);
+		{
+			ThreadPool pool;
+			for (size_t f = 0; f < files.size(); f++) {
+				pool.Submit([this, &files, &mips, f] {
+					int width, height, nrChannels;
+					unsigned char *data = stbi_load(files[f].c_str(), &width, &height, &nrChannels, 4);
+					if (not data)
+						return;
+
+					std::vector<std::vector<unsigned char>> &levels = mips[f];
+					levels.push_back(resample_rgba(data, width, height, Size));
+					stbi_image_free(data);
+					for (int level = 1; level < Levels; level++) {
+						int dim = Size >> (level - 1);
+						levels.push_back(resample_rgba(levels.back().data(), dim, dim, std::max(dim / 2, 1)));
+					}
+				});
+			}
+			pool.Wait();
+		}
+
+		LayerCount = 1;
+		fileLayers.clear();
+		for (size_t f = 0; f < files.size(); f++) {
+			if (mips[f].empty()) {
+				print_failure("Failed to load block texture from " + files[f]);
+				fileLayers.push_back(0);
+			} else {
+				print_success("Loaded block texture from " + files[f]);
+				fileLayers.push_back(LayerCount++);
+			}
+		}
+
+		std::vector<unsigned char> pixels;
+		pixels.reserve(pixelBytes());
+		for (int level = 0; level < Levels; level++) {
+			pixels.insert(pixels.end(), levelBytes(level), 255);
+			for (size_t f = 0; f < files.size(); f++)
+				if (not mips[f].empty())
+					pixels.insert(pixels.end(), mips[f][level].begin(), mips[f][level].end());
+		}
+		return pixels;
+	}
+
+	// Cache file: a header of uint32 magic, size, levels, layer count and
+	// file count, then per file its path length, path, FileStamp and layer,
+	// then the pixels as upload wants them.
+	void writeCache(const std::string &path, const std::vector<std::string> &files,
+			const std::vector<int> &fileLayers, const std::vector<unsigned char> &pixels) {
+		std::vector<uint8_t> out;
+		auto put = [&](const void *data, size_t length) {
+			out.insert(out.end(), (const uint8_t *)data, (const uint8_t *)data + length);
+		};
+
+		uint32_t header[5] = { CACHE_MAGIC, (uint32_t)Size, (uint32_t)Levels, (uint32_t)LayerCount, (uint32_t)files.size() };
+		put(header, sizeof(header));
+		for (size_t f = 0; f < files.size(); f++) {
+			uint32_t length = files[f].size();
+			FileStamp s = stamp(files[f]);
+			int32_t layer = fileLayers[f];
+			put(&length, sizeof(length));
+			put(files[f].data(), length);
+			put(&s, sizeof(s));
+			put(&layer, sizeof(layer));
+		}
+		put(pixels.data(), pixels.size());
+
+		// written aside and renamed, so a crash never leaves half a cache
+		std::string temp = path + ".tmp";
+		FILE *file = fopen(temp.c_str(), "wb");
+		if (not file or fwrite(out.data(), 1, out.size(), file) != out.size()) {
+			if (file)
+				fclose(file);
+			print_failure("Failed to write block texture cache " + path);
+			return;
+		}
+		fclose(file);
+		if (rename(temp.c_str(), path.c_str()) != 0)
+			print_failure("Failed to write block texture cache " + path);
+	}
+
+	// Uploads the cache at path if it was made from exactly these files,
+	// unchanged since. Returns false, touching nothing, otherwise.
+	bool loadCache(const std::string &path, const std::vector<std::string> &files, std::vector<int> &fileLayers) {
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		void *mapped = MAP_FAILED;
+		if (fstat(fd, &st) == 0 and st.st_size > 0)
+			mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapped == MAP_FAILED)
+			return false;
+
+		const uint8_t *data = (const uint8_t *)mapped;
+		size_t length = st.st_size, offset = 0;
+		auto get = [&](void *out, size_t n) {
+			if (length - offset < n)
+				return false;
+			memcpy(out, data + offset, n);
+			offset += n;
+			return true;
+		};
+
+		bool valid = false;
+		std::vector<int> layers;
+		uint32_t header[5];
+		if (get(header, sizeof(header)) and header[0] == CACHE_MAGIC and header[1] == (uint32_t)Size
+				and header[2] == (uint32_t)Levels and header[4] == files.size()) {
+			valid = true;
+			for (size_t f = 0; f < files.size() and valid; f++) {
+				uint32_t nameLength;
+				FileStamp cached, current = stamp(files[f]);
+				int32_t layer;
+				valid = get(&nameLength, sizeof(nameLength)) and length - offset >= nameLength
+					and std::string((const char *)data + offset, nameLength) == files[f];
+				offset += valid ? nameLength : 0;
+				valid = valid and get(&cached, sizeof(cached)) and get(&layer, sizeof(layer))
+					and cached.MTime == current.MTime and cached.Bytes == current.Bytes
+					and layer >= 0 and layer < (int32_t)header[3];
+				layers.push_back(layer);
+			}
+		}
+
+		valid = valid and length - offset == pixelBytes(header[3]);
+		if (valid) {
+			LayerCount = header[3];
+			fileLayers = layers;
+			upload(data + offset);
+		}
+
+		munmap(mapped, st.st_size);
+		return valid;
+	}
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef CAMERAUNIFORMS_H
+#define CAMERAUNIFORMS_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "shader.h"
+
+// binding point of the Camera uniform block
+const unsigned int CAMERA_UNIFORMS_BINDING = 0;
+
+// The camera matrices in a uniform buffer shared by every program that
+// declares
+//
+//   layout (std140) uniform Camera {
+//       mat4 view;
+//       mat4 projection;
+//   };
+//
+// so they're sent once per frame rather than once per program.
+class CameraUniforms {
+public:
+	unsigned int UBO;
+
+	// std140 layout of the block: two column major mat4s, no padding
+	struct Block {
+		glm::mat4 View;
+		glm::mat4 Projection;
+	};
+
+	CameraUniforms() {
+		glGenBuffers(1, &UBO);
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), NULL, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORMS_BINDING, UBO);
+	}
+
+	~CameraUniforms() {
+		glDeleteBuffers(1, &UBO);
+	}
+
+	CameraUniforms(const CameraUniforms&) = delete;
+	CameraUniforms& operator=(const CameraUniforms&) = delete;
+
+	// Points shader's Camera block at this buffer, once after linking
+	void Attach(Shader &shader) {
+		shader.BindUniformBlock("Camera", CAMERA_UNIFORMS_BINDING);
+	}
+
+	void Update(const glm::mat4 &view, const glm::mat4 &projection) {
+		Block block = { view, projection };
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+	}
+};
+
+#endif
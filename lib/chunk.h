@@ -1,43 +1,143 @@
 #ifndef CHUNK_H
 #define CHUNK_H
 
-#include "cube.h"
 #include "block.h"
+#include "palette.h"
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cstdint>
+
+const int CHUNK_SIZE = 16;
+const int CHUNK_VOLUME = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+
+// Chunks are remeshed in horizontal slabs of SECTION_HEIGHT cubes, so an
+// edit only rebuilds the few sections that can see it
+const int SECTION_HEIGHT = 4;
+const int CHUNK_SECTIONS = CHUNK_SIZE / SECTION_HEIGHT;
+const uint32_t ALL_SECTIONS = (1u << CHUNK_SECTIONS) - 1;
 
 class Chunk {
 public:
-	Cube cubes[16][16][16];
+	// cube (x, y, z) lives at Blocks.Get(Index(x, y, z)), its position is implied
+	PalettedContainer Blocks;
+
+	// chunk coordinates, the chunk covers cubes X*CHUNK_SIZE .. X*CHUNK_SIZE+15
+	int X = 0, Y = 0, Z = 0;
+
+	// bit s set when section s (cubes y = s*SECTION_HEIGHT ..) changed since
+	// it was last meshed, cleared by whoever remeshes the chunk
+	uint32_t DirtySections = ALL_SECTIONS;
 	
-	Chunk() {
-		for (int i = 0; i < 16; i++) {
-			for (int j = 0; j < 16; j++) {
-				for (int k = 0; k < 16; k++) {
-					SetCube(i, j, k,
-							Block({i/15.0f, j/15.0f, k/15.0f}));
-				}
-			}
-		}
+	Chunk() : Blocks(CHUNK_VOLUME, BLOCK_STONE) {
 	}
 
-	Chunk(int height[16][16]) {
+	Chunk(BlockID fill) : Blocks(CHUNK_VOLUME, fill) {
+	}
+
+	Chunk(int height[16][16]) : Blocks(CHUNK_VOLUME) {
+		BlockID blocks[CHUNK_VOLUME];
 		for (int i = 0; i < 16; i++) {
 			for (int j = 0; j < 16; j++) {
 				for (int k = 0; k < 16; k++) {
-					if (height[i][j] > k) {
-						SetCube(i, k, j,
-								Block({i/15.0f, k/15.0f, j/15.0f}));
-					} else {
-						SetCube(i, k, j,
-								Block({-1.0f, -1.0f, -1.0f}));
-					}
+					int depth = height[i][j] - 1 - k;
+					BlockID &b = blocks[Index(i, k, j)];
+					if (depth < 0)
+						b = BLOCK_AIR;
+					else if (depth == 0)
+						b = BLOCK_GRASS;
+					else if (depth < 4)
+						b = BLOCK_DIRT;
+					else
+						b = BLOCK_STONE;
 				}
 			}
 		}
+		SetBlocks(blocks);
+	}
+
+	static int Index(int x, int y, int z) {
+		return (y * CHUNK_SIZE + z) * CHUNK_SIZE + x;
+	}
+
+	void SetCube(int x, int y, int z, BlockID b) {
+		Blocks.Set(Index(x, y, z), b);
+		MarkDirty(y);
+	}
+
+	// Replaces every cube at once, blocks[Index(x, y, z)] going to (x, y, z)
+	void SetBlocks(const BlockID *blocks) {
+		Blocks.Assign(blocks);
+		MarkDirty();
+	}
+
+	bool IsDirty() const {
+		return DirtySections != 0;
+	}
+
+	void MarkDirty() {
+		DirtySections = ALL_SECTIONS;
+	}
+
+	// Marks the sections whose mesh shows cube layer y. y may be -1 or
+	// CHUNK_SIZE, for edits in the neighbour below or above.
+	void MarkDirty(int y) {
+		int first = std::max(y - 1, 0) / SECTION_HEIGHT;
+		int last = std::min(y + 1, CHUNK_SIZE - 1) / SECTION_HEIGHT;
+		for (int s = first; s <= last; s++)
+			DirtySections |= 1u << s;
+	}
+
+	BlockID GetBlock(int x, int y, int z) const {
+		return Blocks.Get(Index(x, y, z));
+	}
+
+	// True when every cube holds the same block, stored as a single value
+	bool IsUniform() const {
+		return Blocks.IsUniform();
+	}
+
+	// Frees the storage of blocks that are no longer used, which turns
+	// chunks that ended up as one block back into uniform ones
+	void Compact() {
+		Blocks.Compact();
+	}
+
+	bool IsAir(int x, int y, int z) const {
+		return GetBlock(x, y, z) == BLOCK_AIR;
+	}
+
+	void Serialize(std::vector<uint8_t> &out) const {
+		Blocks.Write(out);
+	}
+
+	// Returns false and leaves the chunk unchanged if data is malformed
+	bool Deserialize(const uint8_t *data, size_t length) {
+		PalettedContainer blocks(CHUNK_VOLUME);
+		if (not blocks.Read(data, length))
+			return false;
+		Blocks = blocks;
+		MarkDirty();
+		return true;
+	}
+
+	// Meshes are built in block space, where cube (x, y, z) spans [x, x+1] on
+	// each axis. This maps them onto the render positions, which have always
+	// put cube (x, y, z) of chunk 0 at (x, 15-y, z).
+	glm::mat4 ModelMatrix() const {
+		return ModelMatrixAt(X, Y, Z);
+	}
+
+	static glm::mat4 ModelMatrixAt(int cx, int cy, int cz) {
+		glm::vec3 origin(cx * CHUNK_SIZE - 0.5f, 15.5f - cy * CHUNK_SIZE, cz * CHUNK_SIZE - 0.5f);
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), origin);
+		return glm::scale(model, glm::vec3(1.0f, -1.0f, 1.0f));
 	}
 
-	void SetCube(int x, int y, int z, Block b) {
-		cubes[x][y][z] = Cube({x, 15-y, z}, b);
+	// Inverse of the mapping above, from a render position (like the
+	// camera's) to block space
+	static glm::vec3 BlockPosition(glm::vec3 renderPosition) {
+		return glm::vec3(renderPosition.x + 0.5f, 15.5f - renderPosition.y, renderPosition.z + 0.5f);
 	}
 };
 
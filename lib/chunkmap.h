@@ -0,0 +1,131 @@
+#ifndef CHUNKMAP_H
+#define CHUNKMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Chunk coordinates packed into one integer, 21 bits per axis
+uint64_t pack_chunk_coord(int cx, int cy, int cz) {
+	const uint64_t MASK = (1u << 21) - 1;
+	return (cx & MASK) << 42 | (cy & MASK) << 21 | (cz & MASK);
+}
+
+void unpack_chunk_coord(uint64_t key, int &cx, int &cy, int &cz) {
+	auto unpack = [](uint64_t bits) {
+		int v = bits & ((1u << 21) - 1);
+		return v & (1 << 20) ? v - (1 << 21) : v;
+	};
+	cx = unpack(key >> 42);
+	cy = unpack(key >> 21);
+	cz = unpack(key);
+}
+
+// Open addressing hash map from packed chunk coordinates to T, with linear
+// probing over a flat array of keys so a lookup is usually one cache line.
+// Erasing shifts the following entries back instead of leaving tombstones.
+template <typename T>
+class ChunkMap {
+public:
+	// packed coordinates only use 63 bits, so this can never be a real key
+	static constexpr uint64_t EMPTY = ~0ull;
+
+	ChunkMap() {
+		rehash(16);
+	}
+
+	size_t Size() const { return count; }
+
+	T* Find(uint64_t key) {
+		for (size_t i = slot(key); keys[i] != EMPTY; i = (i + 1) & mask)
+			if (keys[i] == key)
+				return &values[i];
+		return nullptr;
+	}
+
+	const T* Find(uint64_t key) const {
+		return const_cast<ChunkMap*>(this)->Find(key);
+	}
+
+	// Returns the value stored under key, default constructing it if needed
+	T& Insert(uint64_t key) {
+		if ((count + 1) * 2 > keys.size())
+			rehash(keys.size() * 2);
+
+		size_t i = slot(key);
+		for (; keys[i] != EMPTY; i = (i + 1) & mask)
+			if (keys[i] == key)
+				return values[i];
+
+		keys[i] = key;
+		values[i] = T();
+		count++;
+		return values[i];
+	}
+
+	bool Erase(uint64_t key) {
+		size_t i = slot(key);
+		for (; keys[i] != key; i = (i + 1) & mask)
+			if (keys[i] == EMPTY)
+				return false;
+
+		// pull back every later entry of the probe run that may sit at i
+		for (size_t j = (i + 1) & mask; keys[j] != EMPTY; j = (j + 1) & mask) {
+			size_t home = slot(keys[j]);
+			if (((j - home) & mask) >= ((j - i) & mask)) {
+				keys[i] = keys[j];
+				values[i] = std::move(values[j]);
+				i = j;
+			}
+		}
+		keys[i] = EMPTY;
+		values[i] = T();
+		count--;
+		return true;
+	}
+
+	// f(key, value) for every entry; the map must not change meanwhile
+	template <typename F>
+	void ForEach(F f) {
+		for (size_t i = 0; i < keys.size(); i++)
+			if (keys[i] != EMPTY)
+				f(keys[i], values[i]);
+	}
+
+private:
+	std::vector<uint64_t> keys;
+	std::vector<T> values;
+	size_t count = 0;
+	size_t mask;
+	int shift;
+
+	// fibonacci hashing, the top bits of the product pick the slot
+	size_t slot(uint64_t key) const {
+		return (key * 0x9e3779b97f4a7c15ull) >> shift;
+	}
+
+	void rehash(size_t capacity) {
+		std::vector<uint64_t> oldKeys(capacity, EMPTY);
+		std::vector<T> oldValues(capacity);
+		oldKeys.swap(keys);
+		oldValues.swap(values);
+
+		mask = capacity - 1;
+		shift = 64;
+		for (size_t c = capacity; c > 1; c >>= 1)
+			shift--;
+
+		for (size_t i = 0; i < oldKeys.size(); i++) {
+			if (oldKeys[i] == EMPTY)
+				continue;
+			size_t j = slot(oldKeys[i]);
+			while (keys[j] != EMPTY)
+				j = (j + 1) & mask;
+			keys[j] = oldKeys[i];
+			values[j] = std::move(oldValues[i]);
+		}
+	}
+};
+
+#endif
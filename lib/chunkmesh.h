@@ -0,0 +1,167 @@
+#ifndef CHUNKMESH_H
+#define CHUNKMESH_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "mesher.h"
+
+// GPU side of a chunk: one vertex buffer split into a slot per section,
+// drawn with a single call. Sections are replaced in place while they fit
+// their slot; only outgrowing it reallocates the buffer.
+class ChunkMesh {
+public:
+	unsigned int VAO, VBO;
+	int VertexCount = 0;
+
+	glm::mat4 Model = glm::mat4(1.0f);
+
+	// world space bounds of the vertices, valid after Upload
+	glm::vec3 BoundsMin, BoundsMax;
+
+	struct Slot {
+		int First = 0;
+		int Count = 0;
+		int Capacity = 0;
+		// block space bounds of the section's vertices
+		glm::vec3 Min, Max;
+	};
+	Slot Sections[CHUNK_SECTIONS];
+
+	ChunkMesh() {
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		bindBuffer();
+	}
+
+	~ChunkMesh() {
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+	}
+
+	ChunkMesh(const ChunkMesh&) = delete;
+	ChunkMesh& operator=(const ChunkMesh&) = delete;
+
+	// Replaces the sections set in the sections mask with data[s]. Model must
+	// be set before uploading, the bounds are computed through it.
+	void Upload(uint32_t sections, const MeshData data[CHUNK_SECTIONS]) {
+		bool fits = true;
+		for (int s = 0; s < CHUNK_SECTIONS; s++)
+			if (sections & (1u << s) and (int)data[s].Vertices.size() > Sections[s].Capacity)
+				fits = false;
+		if (not fits)
+			grow(sections, data);
+
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		VertexCount = 0;
+		for (int s = 0; s < CHUNK_SECTIONS; s++) {
+			Slot &slot = Sections[s];
+			if (sections & (1u << s)) {
+				const std::vector<ChunkVertex> &vertices = data[s].Vertices;
+				slot.Count = vertices.size();
+				if (slot.Count > 0)
+					glBufferSubData(GL_ARRAY_BUFFER, slot.First * sizeof(ChunkVertex),
+							slot.Count * sizeof(ChunkVertex), vertices.data());
+				sectionBounds(slot, vertices);
+			}
+			VertexCount += slot.Count;
+		}
+		updateBounds();
+	}
+
+	void Draw() {
+		if (VertexCount == 0)
+			return;
+		GLint first[CHUNK_SECTIONS];
+		GLsizei count[CHUNK_SECTIONS];
+		for (int s = 0; s < CHUNK_SECTIONS; s++) {
+			first[s] = Sections[s].First;
+			count[s] = Sections[s].Count;
+		}
+		glBindVertexArray(VAO);
+		glMultiDrawArrays(GL_TRIANGLES, first, count, CHUNK_SECTIONS);
+		glBindVertexArray(0);
+	}
+
+private:
+	void bindBuffer() {
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glVertexAttribIPointer(0, 2, GL_UNSIGNED_INT, sizeof(ChunkVertex), (void *) 0);
+		glEnableVertexAttribArray(0);
+		glBindVertexArray(0);
+	}
+
+	// Lays the slots out again with room to spare for the sections about to
+	// be uploaded, copying the others over on the GPU
+	void grow(uint32_t sections, const MeshData data[CHUNK_SECTIONS]) {
+		int total = 0;
+		int first[CHUNK_SECTIONS], capacity[CHUNK_SECTIONS];
+		for (int s = 0; s < CHUNK_SECTIONS; s++) {
+			int needed = sections & (1u << s) ? data[s].Vertices.size() : Sections[s].Count;
+			// whole quads, plus a quarter for later edits
+			capacity[s] = std::max(Sections[s].Capacity, (needed + needed / 4 + 5) / 6 * 6);
+			first[s] = total;
+			total += capacity[s];
+		}
+
+		unsigned int buffer;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, total * sizeof(ChunkVertex), NULL, GL_DYNAMIC_DRAW);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+		for (int s = 0; s < CHUNK_SECTIONS; s++) {
+			if (not (sections & (1u << s)) and Sections[s].Count > 0)
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+						Sections[s].First * sizeof(ChunkVertex), first[s] * sizeof(ChunkVertex),
+						Sections[s].Count * sizeof(ChunkVertex));
+			Sections[s].First = first[s];
+			Sections[s].Capacity = capacity[s];
+		}
+
+		glDeleteBuffers(1, &VBO);
+		VBO = buffer;
+		bindBuffer();
+	}
+
+	static void sectionBounds(Slot &slot, const std::vector<ChunkVertex> &vertices) {
+		if (vertices.empty())
+			return;
+		slot.Min = slot.Max = vertices[0].Position();
+		for (const ChunkVertex &v : vertices) {
+			glm::vec3 p = v.Position();
+			for (int a = 0; a < 3; a++) {
+				slot.Min[a] = std::min(slot.Min[a], p[a]);
+				slot.Max[a] = std::max(slot.Max[a], p[a]);
+			}
+		}
+	}
+
+	void updateBounds() {
+		if (VertexCount == 0)
+			return;
+
+		glm::vec3 lo((float)CHUNK_SIZE), hi(0.0f);
+		for (const Slot &slot : Sections) {
+			if (slot.Count == 0)
+				continue;
+			for (int a = 0; a < 3; a++) {
+				lo[a] = std::min(lo[a], slot.Min[a]);
+				hi[a] = std::max(hi[a], slot.Max[a]);
+			}
+		}
+		glm::vec4 p = Model * glm::vec4(lo, 1.0f), q = Model * glm::vec4(hi, 1.0f);
+		for (int a = 0; a < 3; a++) {
+			BoundsMin[a] = std::min(p[a], q[a]);
+			BoundsMax[a] = std::max(p[a], q[a]);
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef CLIMATE_H
+#define CLIMATE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "block.h"
+#include "chunk.h"
+#include "chunkmap.h"
+#include "noise.h"
+#include "world.h"
+
+// Climate changes over hundreds of cubes, so it's sampled every
+// CLIMATE_STEP cubes, CLIMATE_REGION chunks square at a time, and
+// bilinearly upsampled for each column
+const int CLIMATE_STEP = 4;
+const int CLIMATE_REGION_BITS = 2;
+const int CLIMATE_REGION = 1 << CLIMATE_REGION_BITS;
+const int CLIMATE_REGION_CUBES = CLIMATE_REGION * CHUNK_SIZE;
+// samples along a region's side, the last shared with the next region so
+// regions agree where they meet
+const int CLIMATE_POINTS = CLIMATE_REGION_CUBES / CLIMATE_STEP + 1;
+// regions kept, least recently used go first; a region is ~2KB
+const size_t CLIMATE_CACHE_REGIONS = 256;
+
+// both within -0.5 .. 0.5, mostly near 0
+struct ColumnClimate {
+	float Temperature;
+	float Humidity;
+};
+
+// climate[x][z] of every column of a chunk, like TerrainGenerator::Heightmap
+typedef ColumnClimate ChunkClimate[CHUNK_SIZE][CHUNK_SIZE];
+
+enum BiomeID {
+	BIOME_TUNDRA,
+	BIOME_PLAINS,
+	BIOME_FOREST,
+	BIOME_SAVANNA,
+	BIOME_DESERT,
+	BIOME_COUNT,
+};
+
+// What the ground looks like where the climate is right for a biome
+struct Biome {
+	const char *Name;
+	// the top solid cube of a column, and the few under it
+	BlockID Surface, Subsoil;
+	// chance that a tree tried on one of its columns grows
+	float Trees;
+};
+
+const Biome BIOMES[BIOME_COUNT] = {
+	{ "tundra",  BLOCK_SNOW,      BLOCK_DIRT, 0.2f  },
+	{ "plains",  BLOCK_GRASS,     BLOCK_DIRT, 0.25f },
+	{ "forest",  BLOCK_GRASS,     BLOCK_DIRT, 1.0f  },
+	{ "savanna", BLOCK_DRY_GRASS, BLOCK_DIRT, 0.15f },
+	{ "desert",  BLOCK_SAND,      BLOCK_SAND, 0.0f  },
+};
+
+BiomeID biome_at(ColumnClimate climate) {
+	if (climate.Temperature < -0.15f)
+		return BIOME_TUNDRA;
+	if (climate.Temperature > 0.15f)
+		return climate.Humidity < 0.0f ? BIOME_DESERT : BIOME_SAVANNA;
+	return climate.Humidity > 0.05f ? BIOME_FOREST : BIOME_PLAINS;
+}
+
+// Temperature and humidity noise over the world, sampled a region at a time
+// and cached. Safe to use from several threads at once.
+class ClimateMap {
+public:
+	FractalNoise Temperature, Humidity;
+
+	ClimateMap(uint32_t seed) : Temperature(seed ^ 0x85ebca6b), Humidity(seed ^ 0xc2b2ae35) {
+		Temperature.Octaves = Humidity.Octaves = 3;
+		Temperature.Frequency = Humidity.Frequency = 1.0f / 512.0f;
+	}
+
+	ClimateMap(const ClimateMap&) = delete;
+	ClimateMap& operator=(const ClimateMap&) = delete;
+
+	// Fills out with the climate of every column of chunk column (cx, cz)
+	void Columns(int cx, int cz, ChunkClimate out) {
+		int rx = cx >> CLIMATE_REGION_BITS, rz = cz >> CLIMATE_REGION_BITS;
+		std::shared_ptr<const Region> r = region(rx, rz);
+
+		int ox = (cx - rx * CLIMATE_REGION) * CHUNK_SIZE, oz = (cz - rz * CLIMATE_REGION) * CHUNK_SIZE;
+		for (int x = 0; x < CHUNK_SIZE; x++)
+			for (int z = 0; z < CHUNK_SIZE; z++)
+				out[x][z] = r->At(ox + x, oz + z);
+	}
+
+	// climate of the single column at world cube (x, z)
+	ColumnClimate At(int x, int z) {
+		int rx = chunk_coord(x) >> CLIMATE_REGION_BITS, rz = chunk_coord(z) >> CLIMATE_REGION_BITS;
+		return region(rx, rz)->At(x - rx * CLIMATE_REGION_CUBES, z - rz * CLIMATE_REGION_CUBES);
+	}
+
+	// how many regions were computed so far, and how many lookups the
+	// cache answered
+	void Stats(uint64_t &computed, uint64_t &hits) {
+		std::lock_guard<std::mutex> lock(mutex);
+		computed = regionsComputed;
+		hits = cacheHits;
+	}
+
+private:
+	struct Region {
+		// samples [z][x], CLIMATE_STEP cubes apart
+		ColumnClimate Samples[CLIMATE_POINTS][CLIMATE_POINTS];
+
+		// bilinear between the samples around cube (x, z) of the region
+		ColumnClimate At(int x, int z) const {
+			int i = x / CLIMATE_STEP, j = z / CLIMATE_STEP;
+			float tx = (x % CLIMATE_STEP) * (1.0f / CLIMATE_STEP), tz = (z % CLIMATE_STEP) * (1.0f / CLIMATE_STEP);
+			const ColumnClimate &a = Samples[j][i], &b = Samples[j][i + 1];
+			const ColumnClimate &c = Samples[j + 1][i], &d = Samples[j + 1][i + 1];
+			auto lerp = [](float p, float q, float t) { return p + t * (q - p); };
+			ColumnClimate out;
+			out.Temperature = lerp(lerp(a.Temperature, b.Temperature, tx), lerp(c.Temperature, d.Temperature, tx), tz);
+			out.Humidity = lerp(lerp(a.Humidity, b.Humidity, tx), lerp(c.Humidity, d.Humidity, tx), tz);
+			return out;
+		}
+	};
+
+	struct Entry {
+		std::shared_ptr<const Region> R;
+		// value of clock when it was last looked up
+		uint64_t LastUsed = 0;
+	};
+
+	std::mutex mutex;
+	ChunkMap<Entry> cache;
+	uint64_t clock = 0;
+	uint64_t regionsComputed = 0, cacheHits = 0;
+
+	// Region (rx, rz), from the cache if it's there. Regions are computed
+	// outside the lock, so a miss never holds up the other threads; two
+	// threads missing the same region both compute it and the first keeps it.
+	std::shared_ptr<const Region> region(int rx, int rz) {
+		uint64_t key = pack_chunk_coord(rx, 0, rz);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			Entry *e = cache.Find(key);
+			if (e) {
+				e->LastUsed = ++clock;
+				cacheHits++;
+				return e->R;
+			}
+		}
+
+		std::shared_ptr<Region> computed = compute(rx, rz);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		regionsComputed++;
+		if (not cache.Find(key) and cache.Size() >= CLIMATE_CACHE_REGIONS)
+			evictOldest();
+		Entry &e = cache.Insert(key);
+		if (not e.R)
+			e.R = computed;
+		e.LastUsed = ++clock;
+		return e.R;
+	}
+
+	// the cache is small, so a scan for the least recently used is cheaper
+	// than keeping a list in order on every hit
+	void evictOldest() {
+		uint64_t oldest = 0, oldestUse = UINT64_MAX;
+		cache.ForEach([&](uint64_t key, Entry &e) {
+			if (e.LastUsed < oldestUse) {
+				oldest = key;
+				oldestUse = e.LastUsed;
+			}
+		});
+		cache.Erase(oldest);
+	}
+
+	std::shared_ptr<Region> compute(int rx, int rz) const {
+		const int COUNT = CLIMATE_POINTS * CLIMATE_POINTS;
+		float x[COUNT], z[COUNT], temperature[COUNT], humidity[COUNT];
+		for (int i = 0; i < COUNT; i++) {
+			x[i] = rx * CLIMATE_REGION_CUBES + i % CLIMATE_POINTS * CLIMATE_STEP;
+			z[i] = rz * CLIMATE_REGION_CUBES + i / CLIMATE_POINTS * CLIMATE_STEP;
+		}
+		Temperature.Sample(x, z, COUNT, temperature);
+		Humidity.Sample(x, z, COUNT, humidity);
+
+		std::shared_ptr<Region> r = std::make_shared<Region>();
+		for (int i = 0; i < COUNT; i++)
+			r->Samples[i / CLIMATE_POINTS][i % CLIMATE_POINTS] = { temperature[i], humidity[i] };
+		return r;
+	}
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef DENSITY_H
+#define DENSITY_H
+
+#include "chunk.h"
+#include "noise.h"
+
+// Density fields (positive is solid) vary slowly enough that sampling them
+// every DENSITY_STEP cubes and interpolating in between looks the same as
+// sampling every cube, for 1/64th of the noise. The lattice spans the chunk
+// borders on both sides, so neighbouring chunks agree where they meet, and
+// DENSITY_ABOVE layers above the chunk, so the cubes near the top can tell
+// how deep below the surface they are.
+const int DENSITY_STEP = 4;
+const int DENSITY_ABOVE = DENSITY_STEP;
+const int DENSITY_HEIGHT = CHUNK_SIZE + DENSITY_ABOVE;
+const int DENSITY_POINTS = CHUNK_SIZE / DENSITY_STEP + 1;
+const int DENSITY_POINTS_Y = DENSITY_HEIGHT / DENSITY_STEP + 1;
+// lattice rows are padded to a whole AVX2 register
+const int DENSITY_ROW = 8;
+static_assert(DENSITY_POINTS <= DENSITY_ROW, "a lattice row must fit one register");
+
+// lattice[ly][lz][lx] is the density at cube (lx, ly, lz) * DENSITY_STEP of
+// the chunk
+typedef float DensityLattice[DENSITY_POINTS_Y][DENSITY_POINTS][DENSITY_ROW];
+// out[y][z][x] for every cube, y running DENSITY_ABOVE past the chunk
+typedef float DensityField[DENSITY_HEIGHT][CHUNK_SIZE][CHUNK_SIZE];
+
+// The lattice row under cubes y, z, interpolated between the rows of the
+// surrounding lattice points
+void density_row(const DensityLattice lattice, int y, int z, float row[DENSITY_ROW]) {
+	int ly = y / DENSITY_STEP, lz = z / DENSITY_STEP;
+	float ty = (y % DENSITY_STEP) * (1.0f / DENSITY_STEP), tz = (z % DENSITY_STEP) * (1.0f / DENSITY_STEP);
+	for (int lx = 0; lx < DENSITY_ROW; lx++) {
+		float a = lattice[ly][lz][lx] + ty * (lattice[ly + 1][lz][lx] - lattice[ly][lz][lx]);
+		float b = lattice[ly][lz + 1][lx] + ty * (lattice[ly + 1][lz + 1][lx] - lattice[ly][lz + 1][lx]);
+		row[lx] = a + tz * (b - a);
+	}
+}
+
+void interpolate_density_scalar(const DensityLattice lattice, DensityField out) {
+	float row[DENSITY_ROW];
+	for (int y = 0; y < DENSITY_HEIGHT; y++) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			density_row(lattice, y, z, row);
+			for (int x = 0; x < CHUNK_SIZE; x++) {
+				int lx = x / DENSITY_STEP;
+				float tx = (x % DENSITY_STEP) * (1.0f / DENSITY_STEP);
+				out[y][z][x] = row[lx] + tx * (row[lx + 1] - row[lx]);
+			}
+		}
+	}
+}
+
+#ifdef NOISE_AVX2
+
+// Same as the scalar version; lattice rows are one register, and each half
+// of a cube row picks its lattice points out of it with a permute
+__attribute__((target("avx2")))
+void interpolate_density_avx2(const DensityLattice lattice, DensityField out) {
+	const float STEP = 1.0f / DENSITY_STEP;
+	__m256 tx = _mm256_setr_ps(0, STEP, 2*STEP, 3*STEP, 0, STEP, 2*STEP, 3*STEP);
+	__m256i low[2] = { _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1), _mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3) };
+	__m256i one = _mm256_set1_epi32(1);
+
+	for (int y = 0; y < DENSITY_HEIGHT; y++) {
+		int ly = y / DENSITY_STEP;
+		__m256 ty = _mm256_set1_ps((y % DENSITY_STEP) * STEP);
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			int lz = z / DENSITY_STEP;
+			__m256 tz = _mm256_set1_ps((z % DENSITY_STEP) * STEP);
+
+			__m256 l00 = _mm256_loadu_ps(lattice[ly][lz]), l10 = _mm256_loadu_ps(lattice[ly + 1][lz]);
+			__m256 l01 = _mm256_loadu_ps(lattice[ly][lz + 1]), l11 = _mm256_loadu_ps(lattice[ly + 1][lz + 1]);
+			__m256 a = _mm256_add_ps(l00, _mm256_mul_ps(ty, _mm256_sub_ps(l10, l00)));
+			__m256 b = _mm256_add_ps(l01, _mm256_mul_ps(ty, _mm256_sub_ps(l11, l01)));
+			__m256 row = _mm256_add_ps(a, _mm256_mul_ps(tz, _mm256_sub_ps(b, a)));
+
+			for (int half = 0; half < 2; half++) {
+				__m256 r0 = _mm256_permutevar8x32_ps(row, low[half]);
+				__m256 r1 = _mm256_permutevar8x32_ps(row, _mm256_add_epi32(low[half], one));
+				_mm256_storeu_ps(&out[y][z][half * 8], _mm256_add_ps(r0, _mm256_mul_ps(tx, _mm256_sub_ps(r1, r0))));
+			}
+		}
+	}
+}
+
+#endif
+
+// Fills in the density of every cube from the lattice, 8 cubes at a time
+// with simd
+void interpolate_density(const DensityLattice lattice, DensityField out, bool simd) {
+#ifdef NOISE_AVX2
+	static_assert(CHUNK_SIZE == 16 and DENSITY_STEP == 4, "the AVX2 version assumes two registers per cube row");
+	if (simd) {
+		interpolate_density_avx2(lattice, out);
+		return;
+	}
+#endif
+	interpolate_density_scalar(lattice, out);
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// Axis aligned boxes kept as separate arrays of centers and half extents,
+// so Frustum::Cull can test four of them per instruction
+struct BoxList {
+	std::vector<float> CX, CY, CZ;
+	std::vector<float> EX, EY, EZ;
+
+	size_t Size() const { return CX.size(); }
+
+	void Clear() {
+		CX.clear(); CY.clear(); CZ.clear();
+		EX.clear(); EY.clear(); EZ.clear();
+	}
+
+	void Add(glm::vec3 min, glm::vec3 max) {
+		glm::vec3 c = (min + max) * 0.5f, e = (max - min) * 0.5f;
+		CX.push_back(c.x); CY.push_back(c.y); CZ.push_back(c.z);
+		EX.push_back(e.x); EY.push_back(e.y); EZ.push_back(e.z);
+	}
+};
+
+class Frustum {
+public:
+	// (a, b, c, d), a point p is inside when a*p.x + b*p.y + c*p.z + d >= 0
+	glm::vec4 Planes[6];
+
+	// Extracts the planes from projection * view (Gribb & Hartmann), so
+	// everything is tested in world space
+	Frustum(const glm::mat4 &m) {
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+			rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+		for (int i = 0; i < 3; i++) {
+			Planes[i*2]     = rows[3] + rows[i];
+			Planes[i*2 + 1] = rows[3] - rows[i];
+		}
+
+		for (glm::vec4 &p : Planes)
+			p = p / glm::length(glm::vec3(p.x, p.y, p.z));
+	}
+
+	bool Intersects(glm::vec3 center, glm::vec3 extent) const {
+		for (const glm::vec4 &p : Planes) {
+			float dist = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+			float radius = fabsf(p.x) * extent.x + fabsf(p.y) * extent.y + fabsf(p.z) * extent.z;
+			if (dist + radius < 0)
+				return false;
+		}
+		return true;
+	}
+
+	// visible[i] becomes 1 if box i is at least partly inside, 0 otherwise.
+	// Returns the number of visible boxes.
+	int Cull(const BoxList &boxes, std::vector<uint8_t> &visible) const {
+		size_t n = boxes.Size(), i = 0;
+		visible.resize(n);
+		int count = 0;
+
+#if defined(__SSE__)
+		__m128 sign = _mm_set1_ps(-0.0f);
+		for (; i + 4 <= n; i += 4) {
+			__m128 cx = _mm_loadu_ps(&boxes.CX[i]), cy = _mm_loadu_ps(&boxes.CY[i]), cz = _mm_loadu_ps(&boxes.CZ[i]);
+			__m128 ex = _mm_loadu_ps(&boxes.EX[i]), ey = _mm_loadu_ps(&boxes.EY[i]), ez = _mm_loadu_ps(&boxes.EZ[i]);
+			__m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+
+			for (const glm::vec4 &p : Planes) {
+				__m128 a = _mm_set1_ps(p.x), b = _mm_set1_ps(p.y), c = _mm_set1_ps(p.z);
+				__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, cx), _mm_mul_ps(b, cy)),
+						_mm_add_ps(_mm_mul_ps(c, cz), _mm_set1_ps(p.w)));
+				__m128 radius = _mm_add_ps(_mm_add_ps(
+						_mm_mul_ps(_mm_andnot_ps(sign, a), ex),
+						_mm_mul_ps(_mm_andnot_ps(sign, b), ey)),
+						_mm_mul_ps(_mm_andnot_ps(sign, c), ez));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, radius), _mm_setzero_ps()));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			for (int k = 0; k < 4; k++) {
+				visible[i + k] = (mask >> k) & 1;
+				count += visible[i + k];
+			}
+		}
+#endif
+
+		for (; i < n; i++) {
+			glm::vec3 c(boxes.CX[i], boxes.CY[i], boxes.CZ[i]);
+			glm::vec3 e(boxes.EX[i], boxes.EY[i], boxes.EZ[i]);
+			visible[i] = Intersects(c, e);
+			count += visible[i];
+		}
+		return count;
+	}
+};
+
+#endif
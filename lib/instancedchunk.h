@@ -0,0 +1,172 @@
+#ifndef INSTANCEDCHUNK_H
+#define INSTANCEDCHUNK_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "mesher.h"
+
+// A unit cube centered on the origin, as printed by genCube.cpp
+// (position, texture coordinate)
+const float CUBE_VERTICES[] = {
+	-0.5, 0.5, 0.5,0.0, 1.0,
+	0.5, 0.5, 0.5,1.0, 1.0,
+	0.5,-0.5, 0.5,1.0, 0.0,
+	0.5,-0.5, 0.5,1.0, 0.0,
+	-0.5,-0.5, 0.5,0.0, 0.0,
+	-0.5, 0.5, 0.5,0.0, 1.0,
+	0.5, 0.5,-0.5,0.0, 1.0,
+	-0.5, 0.5,-0.5,1.0, 1.0,
+	-0.5,-0.5,-0.5,1.0, 0.0,
+	-0.5,-0.5,-0.5,1.0, 0.0,
+	0.5,-0.5,-0.5,0.0, 0.0,
+	0.5, 0.5,-0.5,0.0, 1.0,
+	-0.5, 0.5,-0.5,0.0, 1.0,
+	-0.5, 0.5, 0.5,1.0, 1.0,
+	-0.5,-0.5, 0.5,1.0, 0.0,
+	-0.5,-0.5, 0.5,1.0, 0.0,
+	-0.5,-0.5,-0.5,0.0, 0.0,
+	-0.5, 0.5,-0.5,0.0, 1.0,
+	0.5, 0.5, 0.5,0.0, 1.0,
+	0.5, 0.5,-0.5,1.0, 1.0,
+	0.5,-0.5,-0.5,1.0, 0.0,
+	0.5,-0.5,-0.5,1.0, 0.0,
+	0.5,-0.5, 0.5,0.0, 0.0,
+	0.5, 0.5, 0.5,0.0, 1.0,
+	-0.5, 0.5,-0.5,0.0, 1.0,
+	0.5, 0.5,-0.5,1.0, 1.0,
+	0.5, 0.5, 0.5,1.0, 0.0,
+	0.5, 0.5, 0.5,1.0, 0.0,
+	-0.5, 0.5, 0.5,0.0, 0.0,
+	-0.5, 0.5,-0.5,0.0, 1.0,
+	0.5,-0.5,-0.5,0.0, 1.0,
+	-0.5,-0.5,-0.5,1.0, 1.0,
+	-0.5,-0.5, 0.5,1.0, 0.0,
+	-0.5,-0.5, 0.5,1.0, 0.0,
+	0.5,-0.5, 0.5,0.0, 0.0,
+	0.5,-0.5,-0.5,0.0, 1.0,
+};
+
+struct CubeInstance {
+	glm::vec3 Position;
+	glm::vec3 Color;
+};
+
+// One instance per solid cube with at least one face showing; cubes
+// buried on all six sides could never be seen. Positions are cube centers
+// in block space.
+std::vector<CubeInstance> chunk_cube_instances(const MeshInput &chunk) {
+	std::vector<CubeInstance> instances;
+	if (chunk.Empty or chunk.Buried)
+		return instances;
+
+	for (int y = 0; y < CHUNK_SIZE; y++) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			for (int x = 0; x < CHUNK_SIZE; x++) {
+				if (chunk.IsAir(x, y, z))
+					continue;
+				if (not chunk.IsAir(x+1, y, z) and not chunk.IsAir(x-1, y, z)
+						and not chunk.IsAir(x, y+1, z) and not chunk.IsAir(x, y-1, z)
+						and not chunk.IsAir(x, y, z+1) and not chunk.IsAir(x, y, z-1))
+					continue;
+
+				glm::vec3 color = block_registry().Get(chunk.GetBlock(x, y, z)).Color;
+				instances.push_back({ glm::vec3(x + 0.5f, y + 0.5f, z + 0.5f), color });
+			}
+		}
+	}
+	return instances;
+}
+
+// A chunk drawn as CUBE_VERTICES instanced once per cube, with a single
+// glDrawArraysInstanced. All chunks share the cube's vertex buffer.
+class InstancedChunk {
+public:
+	unsigned int VAO, InstanceVBO;
+	int InstanceCount = 0;
+
+	glm::mat4 Model = glm::mat4(1.0f);
+
+	// world space bounds of the cubes, valid after Upload
+	glm::vec3 BoundsMin, BoundsMax;
+
+	InstancedChunk() {
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO());
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *) 0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+
+		glGenBuffers(1, &InstanceVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, InstanceVBO);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (void *) offsetof(CubeInstance, Position));
+		glEnableVertexAttribArray(2);
+		glVertexAttribDivisor(2, 1);
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (void *) offsetof(CubeInstance, Color));
+		glEnableVertexAttribArray(3);
+		glVertexAttribDivisor(3, 1);
+
+		glBindVertexArray(0);
+	}
+
+	~InstancedChunk() {
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &InstanceVBO);
+	}
+
+	InstancedChunk(const InstancedChunk&) = delete;
+	InstancedChunk& operator=(const InstancedChunk&) = delete;
+
+	// Model must be set before uploading, the bounds are computed through it
+	void Upload(const std::vector<CubeInstance> &instances) {
+		InstanceCount = instances.size();
+		if (InstanceCount == 0)
+			return;
+
+		glm::vec3 lo = instances[0].Position, hi = lo;
+		for (const CubeInstance &c : instances) {
+			for (int a = 0; a < 3; a++) {
+				lo[a] = std::min(lo[a], c.Position[a]);
+				hi[a] = std::max(hi[a], c.Position[a]);
+			}
+		}
+		glm::vec4 p = Model * glm::vec4(lo - glm::vec3(0.5f), 1.0f);
+		glm::vec4 q = Model * glm::vec4(hi + glm::vec3(0.5f), 1.0f);
+		for (int a = 0; a < 3; a++) {
+			BoundsMin[a] = std::min(p[a], q[a]);
+			BoundsMax[a] = std::max(p[a], q[a]);
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, InstanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, InstanceCount * sizeof(CubeInstance), instances.data(), GL_STATIC_DRAW);
+	}
+
+	void Draw() {
+		if (InstanceCount == 0)
+			return;
+		glBindVertexArray(VAO);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 36, InstanceCount);
+		glBindVertexArray(0);
+	}
+
+private:
+	static unsigned int cubeVBO() {
+		static unsigned int vbo = 0;
+		if (not vbo) {
+			glGenBuffers(1, &vbo);
+			glBindBuffer(GL_ARRAY_BUFFER, vbo);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_VERTICES), CUBE_VERTICES, GL_STATIC_DRAW);
+		}
+		return vbo;
+	}
+};
+
+#endif
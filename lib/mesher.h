@@ -0,0 +1,503 @@
+#ifndef MESHER_H
+#define MESHER_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "chunk.h"
+
+// Faces are numbered axis*2 + (negative side ? 1 : 0)
+enum Face {
+	FACE_POS_X, FACE_NEG_X,
+	FACE_POS_Y, FACE_NEG_Y,
+	FACE_POS_Z, FACE_NEG_Z,
+};
+
+enum MeshMode {
+	MESH_CULLED,
+	MESH_GREEDY,
+	MESH_BINARY,
+	MESH_MODE_COUNT,
+};
+
+const char* mesh_mode_name(MeshMode mode) {
+	switch (mode) {
+		case MESH_CULLED: return "culled";
+		case MESH_GREEDY: return "greedy";
+		case MESH_BINARY: return "binary";
+		default:          break;
+	}
+	return "unknown";
+}
+
+// Chunk mesh vertices are packed into two integers, decoded by
+// shader/shader.vert:
+//   Data0: x | y << 6 | z << 12 | face << 18 | ao << 21
+//   Data1: block << 0 | u << 16 | v << 22
+// (x, y, z) is the corner in chunk space, (u, v) the texture coordinate in
+// cubes (greedy quads repeat the texture), and ao 0 (dark) to 3 (unoccluded).
+struct ChunkVertex {
+	uint32_t Data0;
+	uint32_t Data1;
+
+	ChunkVertex(int x, int y, int z, int face, int ao, int u, int v, BlockID block) {
+		Data0 = x | y << 6 | z << 12 | face << 18 | ao << 21;
+		Data1 = block | u << 16 | v << 22;
+	}
+
+	// already packed as above
+	ChunkVertex(uint32_t data0, uint32_t data1) : Data0(data0), Data1(data1) {
+	}
+
+	glm::vec3 Position() const {
+		return glm::vec3(Data0 & 63, (Data0 >> 6) & 63, (Data0 >> 12) & 63);
+	}
+	int Face() const     { return (Data0 >> 18) & 7; }
+	int AO() const       { return (Data0 >> 21) & 3; }
+	BlockID Block() const { return Data1 & 0xffff; }
+};
+
+static_assert(CHUNK_SIZE <= 32, "vertex positions are packed in 6 bits");
+
+struct MeshData {
+	std::vector<ChunkVertex> Vertices;
+};
+
+// Everything a chunk's mesh depends on: its own blocks plus a one cube border
+// taken from the 26 chunks around it, copied up front so the meshers never
+// look anything up. Cubes are addressed in chunk space, -1 .. CHUNK_SIZE.
+struct MeshInput {
+	static constexpr int SIZE = CHUNK_SIZE + 2;
+
+	BlockID Blocks[SIZE * SIZE * SIZE];
+
+	// the chunk itself is all air
+	bool Empty;
+	// the chunk is uniformly solid and so are the face neighbours touching it
+	bool Buried;
+
+	// A chunk on its own, surrounded by air
+	explicit MeshInput(const Chunk &chunk) {
+		const Chunk *chunks[27] = {};
+		chunks[13] = &chunk;
+		Gather(chunks);
+	}
+
+	// chunks[(dy+1)*9 + (dz+1)*3 + (dx+1)] is the neighbour at offset
+	// (dx, dy, dz) of chunks[13]; missing neighbours are nullptr and count as air
+	explicit MeshInput(const Chunk *chunks[27]) {
+		Gather(chunks);
+	}
+
+	static int Index(int x, int y, int z) {
+		return ((y + 1) * SIZE + (z + 1)) * SIZE + (x + 1);
+	}
+
+	BlockID GetBlock(int x, int y, int z) const {
+		return Blocks[Index(x, y, z)];
+	}
+
+	bool IsAir(int x, int y, int z) const {
+		return GetBlock(x, y, z) == BLOCK_AIR;
+	}
+
+	void Gather(const Chunk *chunks[27]) {
+		const Chunk &center = *chunks[13];
+		auto part = [](int c) { return c < 0 ? 0 : (c < CHUNK_SIZE ? 1 : 2); };
+
+		for (int y = -1; y <= CHUNK_SIZE; y++) {
+			for (int z = -1; z <= CHUNK_SIZE; z++) {
+				for (int x = -1; x <= CHUNK_SIZE; x++) {
+					const Chunk *c = chunks[part(y) * 9 + part(z) * 3 + part(x)];
+					Blocks[Index(x, y, z)] = c ? c->GetBlock((x + CHUNK_SIZE) % CHUNK_SIZE,
+							(y + CHUNK_SIZE) % CHUNK_SIZE, (z + CHUNK_SIZE) % CHUNK_SIZE) : BLOCK_AIR;
+				}
+			}
+		}
+
+		Empty = center.IsUniform() and center.GetBlock(0, 0, 0) == BLOCK_AIR;
+		Buried = center.IsUniform() and not Empty;
+		for (int a = 0; a < CHUNK_SIZE and Buried; a++) {
+			for (int b = 0; b < CHUNK_SIZE and Buried; b++) {
+				Buried = not IsAir(-1, a, b) and not IsAir(CHUNK_SIZE, a, b)
+					and not IsAir(a, -1, b) and not IsAir(a, CHUNK_SIZE, b)
+					and not IsAir(a, b, -1) and not IsAir(a, b, CHUNK_SIZE);
+			}
+		}
+	}
+};
+
+// Four corner AO values of a face with nothing around it
+const uint8_t AO_NONE = 0xff;
+
+// Ambient occlusion of the four corners of the face of cube (x, y, z), two
+// bits per corner in emit_quad's corner order. A corner gets 3 minus the
+// solid cubes among the two edge neighbours and the diagonal in front of
+// it, or 0 when both edges are solid. solid(x, y, z) tells whether a cube
+// is solid and must accept coordinates one outside the chunk.
+template <typename Solid>
+uint8_t face_ao(const Solid &solid, int face, int x, int y, int z) {
+	int axis = face / 2;
+	int ua = (axis + 1) % 3, va = (axis + 2) % 3;
+
+	// the 3x3 ring of cubes in front of the face, ring[du+1][dv+1]
+	bool ring[3][3];
+	for (int du = -1; du <= 1; du++) {
+		for (int dv = -1; dv <= 1; dv++) {
+			if (du == 0 and dv == 0)
+				continue;
+			int p[3] = { x, y, z };
+			p[axis] += face % 2 ? -1 : 1;
+			p[ua] += du;
+			p[va] += dv;
+			ring[du + 1][dv + 1] = solid(p[0], p[1], p[2]);
+		}
+	}
+
+	static const int corners[4][2] = { {0, 0}, {2, 0}, {2, 2}, {0, 2} };
+	uint8_t ao = 0;
+	for (int i = 0; i < 4; i++) {
+		int cu = corners[i][0], cv = corners[i][1];
+		bool side1 = ring[cu][1], side2 = ring[1][cv], corner = ring[cu][cv];
+		int value = side1 and side2 ? 0 : 3 - (side1 + side2 + corner);
+		ao |= value << (i * 2);
+	}
+	return ao;
+}
+
+// Emits a w*h quad lying on the given face of the cube slab `slice`.
+// (u, v) is the quad's corner along the two axes following the face axis,
+// ao the corner values from face_ao.
+void emit_quad(MeshData &mesh, int face, int slice, int u, int v, int w, int h, BlockID block,
+		uint8_t ao = AO_NONE) {
+	int axis = face / 2;
+	int ua = (axis + 1) % 3, va = (axis + 2) % 3;
+	bool negative = face % 2;
+
+	// the corners differ only by w along u and h along v, in position and
+	// texture coordinate both, which add straight into the packed fields
+	int origin[3];
+	origin[axis] = negative ? slice : slice + 1;
+	origin[ua] = u;
+	origin[va] = v;
+	uint32_t data0 = ChunkVertex(origin[0], origin[1], origin[2], face, 0, 0, 0, 0).Data0;
+	uint32_t alongU = w << (ua * 6), alongV = h << (va * 6);
+	uint32_t data1 = block, texU = w << 16, texV = h << 22;
+	const uint32_t corners[4][2] = {
+		{ data0,                   data1 },
+		{ data0 + alongU,          data1 | texU },
+		{ data0 + alongU + alongV, data1 | texU | texV },
+		{ data0 + alongV,          data1 | texV },
+	};
+	int values[4];
+	for (int i = 0; i < 4; i++)
+		values[i] = (ao >> (i * 2)) & 3;
+
+	// u x v points along +axis, so the negative faces walk the corners
+	// backwards. The split runs along the diagonal 0-2 unless that would
+	// stretch the darker pair across the quad.
+	static const int order[2][2][6] = {
+		{ { 0, 1, 2, 2, 3, 0 }, { 1, 2, 3, 3, 0, 1 } },
+		{ { 0, 3, 2, 2, 1, 0 }, { 1, 0, 3, 3, 2, 1 } },
+	};
+	bool flip = values[0] + values[2] > values[1] + values[3];
+	for (int i : order[negative][flip])
+		mesh.Vertices.push_back(ChunkVertex(corners[i][0] | values[i] << 21, corners[i][1]));
+}
+
+// The meshers only emit faces of cubes with y0 <= y < y1, so a chunk can be
+// meshed one section at a time; cubes outside the range still hide faces.
+
+// One quad per cube face that borders air
+MeshData mesh_chunk_culled(const MeshInput &chunk, int y0 = 0, int y1 = CHUNK_SIZE) {
+	static const int offsets[6][3] = {
+		{ 1, 0, 0 }, { -1, 0, 0 },
+		{ 0, 1, 0 }, { 0, -1, 0 },
+		{ 0, 0, 1 }, { 0, 0, -1 },
+	};
+
+	auto solid = [&](int x, int y, int z) { return not chunk.IsAir(x, y, z); };
+
+	MeshData mesh;
+	for (int x = 0; x < CHUNK_SIZE; x++) {
+		for (int y = y0; y < y1; y++) {
+			for (int z = 0; z < CHUNK_SIZE; z++) {
+				if (chunk.IsAir(x, y, z))
+					continue;
+
+				int pos[3] = { x, y, z };
+				BlockID block = chunk.GetBlock(x, y, z);
+				for (int face = 0; face < 6; face++) {
+					const int *o = offsets[face];
+					if (not chunk.IsAir(x + o[0], y + o[1], z + o[2]))
+						continue;
+
+					int axis = face / 2;
+					emit_quad(mesh, face, pos[axis],
+							pos[(axis + 1) % 3], pos[(axis + 2) % 3], 1, 1, block,
+							face_ao(solid, face, x, y, z));
+				}
+			}
+		}
+	}
+	return mesh;
+}
+
+// Same as mesh_chunk_culled, but coplanar faces of the same block and AO are
+// merged into maximal rectangles, one slice at a time
+MeshData mesh_chunk_greedy(const MeshInput &chunk, int y0 = 0, int y1 = CHUNK_SIZE) {
+	struct MaskEntry {
+		bool Visible;
+		BlockID B;
+		uint8_t AO;
+	};
+	auto solid = [&](int x, int y, int z) { return not chunk.IsAir(x, y, z); };
+
+	MeshData mesh;
+	MaskEntry mask[CHUNK_SIZE][CHUNK_SIZE];
+
+	for (int face = 0; face < 6; face++) {
+		int axis = face / 2;
+		int ua = (axis + 1) % 3, va = (axis + 2) % 3;
+		int step = face % 2 ? -1 : 1;
+
+		int first = axis == 1 ? y0 : 0, last = axis == 1 ? y1 : CHUNK_SIZE;
+		for (int slice = first; slice < last; slice++) {
+			for (int u = 0; u < CHUNK_SIZE; u++) {
+				for (int v = 0; v < CHUNK_SIZE; v++) {
+					int pos[3];
+					pos[axis] = slice; pos[ua] = u; pos[va] = v;
+
+					MaskEntry &m = mask[u][v];
+					m.Visible = pos[1] >= y0 and pos[1] < y1
+						and not chunk.IsAir(pos[0], pos[1], pos[2]);
+					if (not m.Visible)
+						continue;
+
+					pos[axis] += step;
+					m.Visible = chunk.IsAir(pos[0], pos[1], pos[2]);
+					pos[axis] -= step;
+					if (m.Visible) {
+						m.B = chunk.GetBlock(pos[0], pos[1], pos[2]);
+						m.AO = face_ao(solid, face, pos[0], pos[1], pos[2]);
+					}
+				}
+			}
+
+			for (int v = 0; v < CHUNK_SIZE; v++) {
+				for (int u = 0; u < CHUNK_SIZE; ) {
+					MaskEntry &m = mask[u][v];
+					if (not m.Visible) {
+						u++;
+						continue;
+					}
+
+					auto same = [&](int mu, int mv) {
+						return mask[mu][mv].Visible and mask[mu][mv].B == m.B and mask[mu][mv].AO == m.AO;
+					};
+
+					int w = 1;
+					while (u + w < CHUNK_SIZE and same(u + w, v))
+						w++;
+
+					int h = 1;
+					for (; v + h < CHUNK_SIZE; h++) {
+						bool full = true;
+						for (int k = 0; k < w and full; k++)
+							full = same(u + k, v + h);
+						if (not full)
+							break;
+					}
+
+					emit_quad(mesh, face, slice, u, v, w, h, m.B, m.AO);
+
+					for (int dv = 0; dv < h; dv++)
+						for (int du = 0; du < w; du++)
+							mask[u + du][v + dv].Visible = false;
+					u += w;
+				}
+			}
+		}
+	}
+	return mesh;
+}
+
+// Greedy meshing on bitmasks. Solidity is stored as one 64 bit column per
+// (axis, u, v) with a bit of padding on each side for the neighbours, so
+// visible faces fall out of a shift, AND and NOT per column. Faces are then
+// scattered into per-slice planes and merged with bit scans; only the block
+// comparisons along a merged run touch the voxels again. AO comes from the
+// same columns, a few bit operations per column and corner.
+MeshData mesh_chunk_binary(const MeshInput &chunk, int y0 = 0, int y1 = CHUNK_SIZE) {
+	static_assert(CHUNK_SIZE + 2 <= 64, "columns must fit in 64 bits with padding");
+	static_assert(CHUNK_SIZE <= 32, "plane rows must fit in 32 bits");
+	const int CS = CHUNK_SIZE, CS_P = CHUNK_SIZE + 2;
+
+	// cols[axis][u+1][v+1], bit i+1 set when the cube at position i along
+	// axis is solid, for i in -1 .. CS
+	uint64_t cols[3][CS_P][CS_P];
+	memset(cols, 0, sizeof(cols));
+
+	// the layers just outside the range only matter to the y columns. In
+	// the order MeshInput stores the cubes, and without branching on them,
+	// since a noisy chunk would mispredict every other one.
+	for (int y = y0 - 1; y <= y1; y++) {
+		for (int z = -1; z <= CS; z++) {
+			const BlockID *row = &chunk.Blocks[MeshInput::Index(-1, y, z)];
+			uint64_t xs = 0;
+			for (int x = -1; x <= CS; x++) {
+				uint64_t solid = row[x + 1] != BLOCK_AIR;
+				xs |= solid << (x + 1);
+				cols[1][z + 1][x + 1] |= solid << (y + 1);
+				cols[2][x + 1][y + 1] |= solid << (z + 1);
+			}
+			cols[0][y + 1][z + 1] = xs;
+		}
+	}
+
+	// planes[face][slice][u], bit v set when that face is visible, with its
+	// face_ao value in aos[face][slice][u][v]
+	uint32_t planes[6][CS][CS];
+	memset(planes, 0, sizeof(planes));
+	uint8_t aos[6][CS][CS][CS];
+
+	// bit i set for y0 <= i < y1, to line up with the shifted faces below
+	const uint64_t range = ((1ull << y1) - 1) & ~((1ull << y0) - 1);
+	for (int axis = 0; axis < 3; axis++) {
+		for (int u = 0; u < CS; u++) {
+			for (int v = 0; v < CS; v++) {
+				// y is u along x and v along z
+				if ((axis == 0 and (u < y0 or u >= y1)) or (axis == 2 and (v < y0 or v >= y1)))
+					continue;
+
+				uint64_t col = cols[axis][u + 1][v + 1];
+				uint64_t faces[2] = {
+					col & ~(col >> 1),	// air after it
+					col & ~(col << 1),	// air before it
+				};
+
+				for (int side = 0; side < 2; side++) {
+					uint64_t bits = (faces[side] >> 1) & (axis == 1 ? range : (1ull << CS) - 1);
+					if (not bits)
+						continue;
+
+					// AO for the whole column at once: ring[du+1][dv+1] has
+					// bit i+1 set when the cube in front of the face at slice
+					// i, offset by (du, dv), is solid
+					uint64_t ring[3][3];
+					for (int du = 0; du < 3; du++) {
+						for (int dv = 0; dv < 3; dv++) {
+							uint64_t c = cols[axis][u + du][v + dv];
+							ring[du][dv] = side ? c << 1 : c >> 1;
+						}
+					}
+					// two bits of each corner's value, see face_ao
+					static const int corners[4][2] = { {0, 0}, {2, 0}, {2, 2}, {0, 2} };
+					uint64_t lo[4], hi[4];
+					for (int i = 0; i < 4; i++) {
+						uint64_t s1 = ring[corners[i][0]][1], s2 = ring[1][corners[i][1]];
+						uint64_t c = ring[corners[i][0]][corners[i][1]];
+						uint64_t both = s1 & s2;
+						uint64_t majority = both | (s1 & c) | (s2 & c);
+						lo[i] = ~(s1 ^ s2 ^ c) & ~both;
+						hi[i] = ~majority;
+					}
+
+					int face = axis * 2 + side;
+					while (bits) {
+						int slice = __builtin_ctzll(bits);
+						bits &= bits - 1;
+						planes[face][slice][u] |= 1u << v;
+
+						uint8_t ao = 0;
+						for (int i = 0; i < 4; i++)
+							ao |= ((lo[i] >> (slice + 1) & 1) | (hi[i] >> (slice + 1) & 1) << 1) << (i * 2);
+						aos[face][slice][u][v] = ao;
+					}
+				}
+			}
+		}
+	}
+
+	// at most a quad per visible face, so reserving for that many never
+	// has to grow the vertices
+	MeshData mesh;
+	int visible = 0;
+	for (int face = 0; face < 6; face++)
+		for (int slice = 0; slice < CS; slice++)
+			for (int u = 0; u < CS; u++)
+				visible += __builtin_popcount(planes[face][slice][u]);
+	mesh.Vertices.reserve(visible * 6);
+
+	// distance between neighbouring cubes of MeshInput::Blocks along x, y, z
+	const int strides[3] = { 1, CS_P * CS_P, CS_P };
+	for (int face = 0; face < 6; face++) {
+		int axis = face / 2;
+		int ua = (axis + 1) % 3, va = (axis + 2) % 3;
+		int strideU = strides[ua], strideV = strides[va];
+
+		for (int slice = 0; slice < CS; slice++) {
+			uint32_t *plane = planes[face][slice];
+			const BlockID *blocks = &chunk.Blocks[MeshInput::Index(0, 0, 0) + slice * strides[axis]];
+			const uint8_t (*sliceAO)[CS] = aos[face][slice];
+
+			// block | ao << 16, faces only merge when both match
+			auto face_at = [&](int u, int v) {
+				return (uint32_t)blocks[u * strideU + v * strideV] | sliceAO[u][v] << 16;
+			};
+			// true when every face in the run [v, v+h) of row u matches f
+			auto run_matches = [&](int u, int v, int h, uint32_t f) {
+				for (int k = 0; k < h; k++)
+					if (face_at(u, v + k) != f)
+						return false;
+				return true;
+			};
+
+			for (int u = 0; u < CS; u++) {
+				while (plane[u]) {
+					int v = __builtin_ctz(plane[u]);
+					uint32_t f = face_at(u, v);
+
+					// longest run of visible faces, cut short at the first other one
+					int h = __builtin_ctz(~(plane[u] >> v));
+					for (int k = 1; k < h; k++) {
+						if (face_at(u, v + k) != f) {
+							h = k;
+							break;
+						}
+					}
+
+					uint32_t run = (h == 32 ? ~0u : (1u << h) - 1) << v;
+					plane[u] &= ~run;
+
+					int w = 1;
+					while (u + w < CS and (plane[u + w] & run) == run
+							and run_matches(u + w, v, h, f)) {
+						plane[u + w] &= ~run;
+						w++;
+					}
+
+					emit_quad(mesh, face, slice, u, v, w, h, f & 0xffff, f >> 16);
+				}
+			}
+		}
+	}
+	return mesh;
+}
+
+// Chunks that are all air, or solid all the way through to their
+// neighbours, have nothing to show and skip the meshers entirely
+MeshData mesh_chunk(const MeshInput &chunk, MeshMode mode, int y0 = 0, int y1 = CHUNK_SIZE) {
+	if (chunk.Empty or chunk.Buried)
+		return MeshData();
+
+	switch (mode) {
+		case MESH_GREEDY: return mesh_chunk_greedy(chunk, y0, y1);
+		case MESH_BINARY: return mesh_chunk_binary(chunk, y0, y1);
+		default:          return mesh_chunk_culled(chunk, y0, y1);
+	}
+}
+
+#endif
@@ -0,0 +1,306 @@
+#ifndef NOISE_H
+#define NOISE_H
+
+#include <cmath>
+#include <cstdint>
+
+// 2D and 3D gradient (Perlin) noise summed over octaves, seeded and evaluated 8
+// samples at a time with AVX2 where the CPU has it. The AVX2 kernels are
+// compiled for that target alone and picked at runtime, so the rest of the
+// program needs no special flags. The scalar code does the same operations
+// in the same order, so both give the same results as long as the compiler
+// doesn't fuse the scalar multiply-adds (as -march=native may).
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__))
+#define NOISE_AVX2
+#include <immintrin.h>
+#endif
+
+// lattice point hashing, the same in both versions
+const uint32_t NOISE_PRIME_X = 0x27d4eb2d;
+const uint32_t NOISE_PRIME_Y = 0x9e3779b9;
+const uint32_t NOISE_PRIME_Z = 0x165667b1;
+const uint32_t NOISE_MIX = 0x9e3779b1;
+// decorrelates the octaves of one seed
+const uint32_t NOISE_OCTAVE_SEED = 0x632be5ab;
+
+// unit gradients 45 degrees apart, chosen by the top 3 bits of a hash
+const float NOISE_GRADIENT_X[8] = { 1.0f, -1.0f, 0.0f, 0.0f, 0.70710678f, -0.70710678f, 0.70710678f, -0.70710678f };
+const float NOISE_GRADIENT_Z[8] = { 0.0f, 0.0f, 1.0f, -1.0f, 0.70710678f, 0.70710678f, -0.70710678f, -0.70710678f };
+
+// in 3D, the 12 cube edge directions (4 of them twice) by the top 4 bits
+const float NOISE_GRADIENT3_X[16] = { 1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0, 1, -1, 0, 0 };
+const float NOISE_GRADIENT3_Y[16] = { 1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1, 1, 1, -1, -1 };
+const float NOISE_GRADIENT3_Z[16] = { 0, 0, 0, 0, 1, 1, -1, -1, 1, 1, -1, -1, 0, 0, 1, -1 };
+
+bool noise_avx2_supported() {
+#ifdef NOISE_AVX2
+	static bool supported = __builtin_cpu_supports("avx2");
+	return supported;
+#else
+	return false;
+#endif
+}
+
+// gradient of the lattice point whose coordinates times the primes are hx, hz
+float noise_corner(uint32_t hx, uint32_t hz, uint32_t seed, float dx, float dz) {
+	uint32_t g = ((seed ^ hx ^ hz) * NOISE_MIX) >> 29;
+	return NOISE_GRADIENT_X[g] * dx + NOISE_GRADIENT_Z[g] * dz;
+}
+
+// 6t^5 - 15t^4 + 10t^3
+float noise_fade(float t) {
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+// Roughly -0.7 .. 0.7, 0 on every integer lattice point
+float gradient_noise(float x, float z, uint32_t seed) {
+	float fx = floorf(x), fz = floorf(z);
+	float dx = x - fx, dz = z - fz;
+	uint32_t hx0 = (uint32_t)(int)fx * NOISE_PRIME_X, hx1 = hx0 + NOISE_PRIME_X;
+	uint32_t hz0 = (uint32_t)(int)fz * NOISE_PRIME_Z, hz1 = hz0 + NOISE_PRIME_Z;
+	float dx1 = dx - 1.0f, dz1 = dz - 1.0f;
+
+	float n00 = noise_corner(hx0, hz0, seed, dx, dz);
+	float n10 = noise_corner(hx1, hz0, seed, dx1, dz);
+	float n01 = noise_corner(hx0, hz1, seed, dx, dz1);
+	float n11 = noise_corner(hx1, hz1, seed, dx1, dz1);
+
+	float u = noise_fade(dx), v = noise_fade(dz);
+	float a = n00 + u * (n10 - n00);
+	float b = n01 + u * (n11 - n01);
+	return a + v * (b - a);
+}
+
+float noise_corner3(uint32_t hx, uint32_t hy, uint32_t hz, uint32_t seed, float dx, float dy, float dz) {
+	uint32_t g = ((seed ^ hx ^ hy ^ hz) * NOISE_MIX) >> 28;
+	return NOISE_GRADIENT3_X[g] * dx + NOISE_GRADIENT3_Y[g] * dy + NOISE_GRADIENT3_Z[g] * dz;
+}
+
+// Roughly -1 .. 1, 0 on every integer lattice point
+float gradient_noise(float x, float y, float z, uint32_t seed) {
+	float fx = floorf(x), fy = floorf(y), fz = floorf(z);
+	float dx = x - fx, dy = y - fy, dz = z - fz;
+	uint32_t hx0 = (uint32_t)(int)fx * NOISE_PRIME_X, hx1 = hx0 + NOISE_PRIME_X;
+	uint32_t hy0 = (uint32_t)(int)fy * NOISE_PRIME_Y, hy1 = hy0 + NOISE_PRIME_Y;
+	uint32_t hz0 = (uint32_t)(int)fz * NOISE_PRIME_Z, hz1 = hz0 + NOISE_PRIME_Z;
+	float dx1 = dx - 1.0f, dy1 = dy - 1.0f, dz1 = dz - 1.0f;
+
+	float u = noise_fade(dx), v = noise_fade(dy), w = noise_fade(dz);
+	float layers[2];
+	for (int i = 0; i < 2; i++) {
+		uint32_t hz = i ? hz1 : hz0;
+		float ddz = i ? dz1 : dz;
+		float n00 = noise_corner3(hx0, hy0, hz, seed, dx, dy, ddz);
+		float n10 = noise_corner3(hx1, hy0, hz, seed, dx1, dy, ddz);
+		float n01 = noise_corner3(hx0, hy1, hz, seed, dx, dy1, ddz);
+		float n11 = noise_corner3(hx1, hy1, hz, seed, dx1, dy1, ddz);
+		float a = n00 + u * (n10 - n00);
+		float b = n01 + u * (n11 - n01);
+		layers[i] = a + v * (b - a);
+	}
+	return layers[0] + w * (layers[1] - layers[0]);
+}
+
+#ifdef NOISE_AVX2
+
+__attribute__((target("avx2")))
+__m256 noise_corner_avx2(__m256i hx, __m256i hz, __m256i seed, __m256 dx, __m256 dz) {
+	__m256i h = _mm256_xor_si256(seed, _mm256_xor_si256(hx, hz));
+	__m256i g = _mm256_srli_epi32(_mm256_mullo_epi32(h, _mm256_set1_epi32((int)NOISE_MIX)), 29);
+	__m256 gx = _mm256_permutevar8x32_ps(_mm256_loadu_ps(NOISE_GRADIENT_X), g);
+	__m256 gz = _mm256_permutevar8x32_ps(_mm256_loadu_ps(NOISE_GRADIENT_Z), g);
+	return _mm256_add_ps(_mm256_mul_ps(gx, dx), _mm256_mul_ps(gz, dz));
+}
+
+__attribute__((target("avx2")))
+__m256 noise_fade_avx2(__m256 t) {
+	__m256 inner = _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f));
+	inner = _mm256_add_ps(_mm256_mul_ps(t, inner), _mm256_set1_ps(10.0f));
+	return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+}
+
+// gradient_noise on 8 points at once
+__attribute__((target("avx2")))
+__m256 gradient_noise_avx2(__m256 x, __m256 z, uint32_t seed) {
+	__m256 fx = _mm256_floor_ps(x), fz = _mm256_floor_ps(z);
+	__m256 dx = _mm256_sub_ps(x, fx), dz = _mm256_sub_ps(z, fz);
+	__m256i primeX = _mm256_set1_epi32((int)NOISE_PRIME_X), primeZ = _mm256_set1_epi32((int)NOISE_PRIME_Z);
+	__m256i hx0 = _mm256_mullo_epi32(_mm256_cvttps_epi32(fx), primeX), hx1 = _mm256_add_epi32(hx0, primeX);
+	__m256i hz0 = _mm256_mullo_epi32(_mm256_cvttps_epi32(fz), primeZ), hz1 = _mm256_add_epi32(hz0, primeZ);
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 dx1 = _mm256_sub_ps(dx, one), dz1 = _mm256_sub_ps(dz, one);
+	__m256i s = _mm256_set1_epi32((int)seed);
+
+	__m256 n00 = noise_corner_avx2(hx0, hz0, s, dx, dz);
+	__m256 n10 = noise_corner_avx2(hx1, hz0, s, dx1, dz);
+	__m256 n01 = noise_corner_avx2(hx0, hz1, s, dx, dz1);
+	__m256 n11 = noise_corner_avx2(hx1, hz1, s, dx1, dz1);
+
+	__m256 u = noise_fade_avx2(dx), v = noise_fade_avx2(dz);
+	__m256 a = _mm256_add_ps(n00, _mm256_mul_ps(u, _mm256_sub_ps(n10, n00)));
+	__m256 b = _mm256_add_ps(n01, _mm256_mul_ps(u, _mm256_sub_ps(n11, n01)));
+	return _mm256_add_ps(a, _mm256_mul_ps(v, _mm256_sub_ps(b, a)));
+}
+
+__attribute__((target("avx2")))
+__m256 noise_corner3_avx2(__m256i hx, __m256i hy, __m256i hz, __m256i seed, __m256 dx, __m256 dy, __m256 dz) {
+	__m256i h = _mm256_xor_si256(_mm256_xor_si256(seed, hx), _mm256_xor_si256(hy, hz));
+	__m256i g = _mm256_srli_epi32(_mm256_mullo_epi32(h, _mm256_set1_epi32((int)NOISE_MIX)), 28);
+	// 16 entry lookups: both halves, then bit 3 (shifted to the sign) picks
+	__m256 high = _mm256_castsi256_ps(_mm256_slli_epi32(g, 28));
+	__m256 gx = _mm256_blendv_ps(_mm256_permutevar8x32_ps(_mm256_loadu_ps(NOISE_GRADIENT3_X), g),
+			_mm256_permutevar8x32_ps(_mm256_loadu_ps(NOISE_GRADIENT3_X + 8), g), high);
+	__m256 gy = _mm256_blendv_ps(_mm256_permutevar8x32_ps(_mm256_loadu_ps(NOISE_GRADIENT3_Y), g),
+			_mm256_permutevar8x32_ps(_mm256_loadu_ps(NOISE_GRADIENT3_Y + 8), g), high);
+	__m256 gz = _mm256_blendv_ps(_mm256_permutevar8x32_ps(_mm256_loadu_ps(NOISE_GRADIENT3_Z), g),
+			_mm256_permutevar8x32_ps(_mm256_loadu_ps(NOISE_GRADIENT3_Z + 8), g), high);
+	return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx, dx), _mm256_mul_ps(gy, dy)), _mm256_mul_ps(gz, dz));
+}
+
+__attribute__((target("avx2")))
+__m256 gradient_noise_avx2(__m256 x, __m256 y, __m256 z, uint32_t seed) {
+	__m256 fx = _mm256_floor_ps(x), fy = _mm256_floor_ps(y), fz = _mm256_floor_ps(z);
+	__m256 dx = _mm256_sub_ps(x, fx), dy = _mm256_sub_ps(y, fy), dz = _mm256_sub_ps(z, fz);
+	__m256i primeX = _mm256_set1_epi32((int)NOISE_PRIME_X), primeY = _mm256_set1_epi32((int)NOISE_PRIME_Y);
+	__m256i primeZ = _mm256_set1_epi32((int)NOISE_PRIME_Z);
+	__m256i hx0 = _mm256_mullo_epi32(_mm256_cvttps_epi32(fx), primeX), hx1 = _mm256_add_epi32(hx0, primeX);
+	__m256i hy0 = _mm256_mullo_epi32(_mm256_cvttps_epi32(fy), primeY), hy1 = _mm256_add_epi32(hy0, primeY);
+	__m256i hz0 = _mm256_mullo_epi32(_mm256_cvttps_epi32(fz), primeZ), hz1 = _mm256_add_epi32(hz0, primeZ);
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 dx1 = _mm256_sub_ps(dx, one), dy1 = _mm256_sub_ps(dy, one), dz1 = _mm256_sub_ps(dz, one);
+	__m256i s = _mm256_set1_epi32((int)seed);
+
+	__m256 u = noise_fade_avx2(dx), v = noise_fade_avx2(dy), w = noise_fade_avx2(dz);
+	__m256 layers[2];
+	for (int i = 0; i < 2; i++) {
+		__m256i hz = i ? hz1 : hz0;
+		__m256 ddz = i ? dz1 : dz;
+		__m256 n00 = noise_corner3_avx2(hx0, hy0, hz, s, dx, dy, ddz);
+		__m256 n10 = noise_corner3_avx2(hx1, hy0, hz, s, dx1, dy, ddz);
+		__m256 n01 = noise_corner3_avx2(hx0, hy1, hz, s, dx, dy1, ddz);
+		__m256 n11 = noise_corner3_avx2(hx1, hy1, hz, s, dx1, dy1, ddz);
+		__m256 a = _mm256_add_ps(n00, _mm256_mul_ps(u, _mm256_sub_ps(n10, n00)));
+		__m256 b = _mm256_add_ps(n01, _mm256_mul_ps(u, _mm256_sub_ps(n11, n01)));
+		layers[i] = _mm256_add_ps(a, _mm256_mul_ps(v, _mm256_sub_ps(b, a)));
+	}
+	return _mm256_add_ps(layers[0], _mm256_mul_ps(w, _mm256_sub_ps(layers[1], layers[0])));
+}
+
+#endif
+
+// Octaves of gradient noise, each Lacunarity times the frequency and
+// Persistence times the amplitude of the one before, scaled back so the sum
+// stays within gradient_noise's range
+class FractalNoise {
+public:
+	uint32_t Seed;
+	int Octaves = 5;
+	// of the first octave, in cycles per cube
+	float Frequency = 1.0f / 64.0f;
+	float Lacunarity = 2.0f;
+	float Persistence = 0.5f;
+
+	// turn off to force the scalar path
+	bool SIMD = noise_avx2_supported();
+
+	FractalNoise(uint32_t seed = 0) : Seed(seed) {
+	}
+
+	float Sample(float x, float z) const {
+		float sum = 0.0f, amplitude = 1.0f, frequency = Frequency;
+		for (int o = 0; o < Octaves; o++) {
+			sum += amplitude * gradient_noise(x * frequency, z * frequency, Seed + o * NOISE_OCTAVE_SEED);
+			frequency *= Lacunarity;
+			amplitude *= Persistence;
+		}
+		return sum * scale();
+	}
+
+	float Sample(float x, float y, float z) const {
+		float sum = 0.0f, amplitude = 1.0f, frequency = Frequency;
+		for (int o = 0; o < Octaves; o++) {
+			sum += amplitude * gradient_noise(x * frequency, y * frequency, z * frequency, Seed + o * NOISE_OCTAVE_SEED);
+			frequency *= Lacunarity;
+			amplitude *= Persistence;
+		}
+		return sum * scale();
+	}
+
+	// Samples the points (x[i], z[i]) into out[i], 8 at a time when SIMD
+	void Sample(const float *x, const float *z, int count, float *out) const {
+		int i = 0;
+#ifdef NOISE_AVX2
+		if (SIMD) {
+			sample8(x, z, count & ~7, out);
+			i = count & ~7;
+		}
+#endif
+		for (; i < count; i++)
+			out[i] = Sample(x[i], z[i]);
+	}
+
+	// and the points (x[i], y[i], z[i])
+	void Sample(const float *x, const float *y, const float *z, int count, float *out) const {
+		int i = 0;
+#ifdef NOISE_AVX2
+		if (SIMD) {
+			sample8(x, y, z, count & ~7, out);
+			i = count & ~7;
+		}
+#endif
+		for (; i < count; i++)
+			out[i] = Sample(x[i], y[i], z[i]);
+	}
+
+private:
+	float scale() const {
+		float total = 0.0f, amplitude = 1.0f;
+		for (int o = 0; o < Octaves; o++) {
+			total += amplitude;
+			amplitude *= Persistence;
+		}
+		return 1.0f / total;
+	}
+
+#ifdef NOISE_AVX2
+	__attribute__((target("avx2")))
+	void sample8(const float *x, const float *z, int count, float *out) const {
+		__m256 s = _mm256_set1_ps(scale());
+		for (int i = 0; i < count; i += 8) {
+			__m256 px = _mm256_loadu_ps(x + i), pz = _mm256_loadu_ps(z + i);
+			__m256 sum = _mm256_setzero_ps();
+			float amplitude = 1.0f, frequency = Frequency;
+			for (int o = 0; o < Octaves; o++) {
+				__m256 f = _mm256_set1_ps(frequency);
+				__m256 n = gradient_noise_avx2(_mm256_mul_ps(px, f), _mm256_mul_ps(pz, f), Seed + o * NOISE_OCTAVE_SEED);
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(amplitude), n));
+				frequency *= Lacunarity;
+				amplitude *= Persistence;
+			}
+			_mm256_storeu_ps(out + i, _mm256_mul_ps(sum, s));
+		}
+	}
+
+	__attribute__((target("avx2")))
+	void sample8(const float *x, const float *y, const float *z, int count, float *out) const {
+		__m256 s = _mm256_set1_ps(scale());
+		for (int i = 0; i < count; i += 8) {
+			__m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+			__m256 sum = _mm256_setzero_ps();
+			float amplitude = 1.0f, frequency = Frequency;
+			for (int o = 0; o < Octaves; o++) {
+				__m256 f = _mm256_set1_ps(frequency);
+				__m256 n = gradient_noise_avx2(_mm256_mul_ps(px, f), _mm256_mul_ps(py, f), _mm256_mul_ps(pz, f),
+						Seed + o * NOISE_OCTAVE_SEED);
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(amplitude), n));
+				frequency *= Lacunarity;
+				amplitude *= Persistence;
+			}
+			_mm256_storeu_ps(out + i, _mm256_mul_ps(sum, s));
+		}
+	}
+#endif
+};
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "block.h"
+
+// Stores Size BlockIDs as indices into a local palette, packed 1, 2, 4 or 8
+// bits per entry. Entries never straddle a 64 bit word, so Get and Set are a
+// shift and a mask. Once more than 256 distinct blocks show up the palette is
+// dropped and the BlockIDs themselves are stored at 16 bits.
+//
+// While every entry holds the same block the width is 0: the palette's only
+// entry is the value and there are no words at all, until a different block
+// is written.
+class PalettedContainer {
+public:
+	static constexpr int DIRECT_BITS = 16;
+
+	int Size;
+	int Bits;
+	std::vector<BlockID> Palette;
+	std::vector<uint64_t> Words;
+
+	PalettedContainer(int size, BlockID fill = BLOCK_AIR) : Size(size) {
+		Reset(fill);
+	}
+
+	// every entry becomes fill, with no storage behind it
+	void Reset(BlockID fill) {
+		Palette.assign(1, fill);
+		resize(0);
+		rebuildLookup();
+	}
+
+	bool IsUniform() const { return Bits == 0; }
+
+	BlockID Get(int i) const {
+		if (Bits == 0)
+			return Palette[0];
+		uint64_t value = (Words[i / perWord] >> ((i % perWord) * Bits)) & valueMask;
+		return Bits == DIRECT_BITS ? value : Palette[value];
+	}
+
+	void Set(int i, BlockID id) {
+		if (Bits == 0) {
+			if (id == Palette[0])
+				return;
+			grow(1);
+		}
+
+		if (Bits != DIRECT_BITS and find(id) < 0)
+			add(id);
+		// add() may have widened the entries, so check the mode again
+		uint64_t value = Bits == DIRECT_BITS ? id : find(id);
+
+		uint64_t &word = Words[i / perWord];
+		int shift = (i % perWord) * Bits;
+		word = (word & ~(valueMask << shift)) | (value << shift);
+	}
+
+	// Replaces all Size entries with values at once, packed at the narrowest
+	// width that holds them; much faster than Setting them one by one
+	void Assign(const BlockID *values) {
+		std::vector<BlockID> used(1, values[0]);
+		for (int i = 1; i < Size and used.size() <= 256; i++)
+			if (values[i] != values[i - 1] and std::find(used.begin(), used.end(), values[i]) == used.end())
+				used.push_back(values[i]);
+
+		int bits = 0;
+		if (used.size() > 256)
+			bits = DIRECT_BITS;
+		while (bits != DIRECT_BITS and (1u << bits) < used.size())
+			bits = bits ? bits * 2 : 1;
+
+		Palette = used;
+		resize(bits);
+		if (bits == DIRECT_BITS)
+			Palette.clear();
+		rebuildLookup();
+		if (bits == 0)
+			return;
+
+		uint64_t value = 0;
+		for (int i = 0; i < Size; i++) {
+			if (i == 0 or values[i] != values[i - 1])
+				value = bits == DIRECT_BITS ? values[i] : find(values[i]);
+			Words[i / perWord] |= value << ((i % perWord) * Bits);
+		}
+	}
+
+	// Drops palette entries nothing refers to anymore and shrinks the width to
+	// match, down to uniform if only one block is left
+	void Compact() {
+		if (Bits == 0)
+			return;
+
+		std::vector<BlockID> values(Size);
+		std::vector<BlockID> used;
+		for (int i = 0; i < Size; i++) {
+			values[i] = Get(i);
+			if (std::find(used.begin(), used.end(), values[i]) == used.end())
+				used.push_back(values[i]);
+			if (used.size() > 256)
+				return;
+		}
+
+		int bits = 0;
+		while ((1u << bits) < used.size())
+			bits = bits ? bits * 2 : 1;
+		if (bits >= Bits)
+			return;
+
+		Palette = used;
+		resize(bits);
+		rebuildLookup();
+		for (int i = 0; bits and i < Size; i++)
+			Words[i / perWord] |= (uint64_t) find(values[i]) << ((i % perWord) * Bits);
+	}
+
+	size_t MemoryUsage() const {
+		return Words.size() * sizeof(uint64_t) + Palette.size() * sizeof(BlockID);
+	}
+
+	// [bits][palette size][palette ids][words], little endian. A uniform
+	// container is just its one palette entry.
+	void Write(std::vector<uint8_t> &out) const {
+		out.push_back(Bits);
+		put16(out, Palette.size());
+		for (BlockID id : Palette)
+			put16(out, id);
+		if (Words.empty())
+			return;
+		size_t at = out.size();
+		out.resize(at + Words.size() * sizeof(uint64_t));
+		memcpy(out.data() + at, Words.data(), Words.size() * sizeof(uint64_t));
+	}
+
+	// Returns the number of bytes consumed, or 0 if data is malformed
+	size_t Read(const uint8_t *data, size_t length) {
+		if (length < 3)
+			return 0;
+		int bits = data[0];
+		size_t count = data[1] | data[2] << 8;
+		if (bits != 0 and bits != 1 and bits != 2 and bits != 4 and bits != 8 and bits != DIRECT_BITS)
+			return 0;
+		if (bits != DIRECT_BITS and (count == 0 or count > (1u << bits)))
+			return 0;
+		// Assign drops the palette once the ids are stored directly
+		if (bits == DIRECT_BITS and count != 0)
+			return 0;
+
+		size_t at = 3 + count * 2;
+		size_t words = bits ? (Size + 64 / bits - 1) / (64 / bits) : 0;
+		if (length < at + words * sizeof(uint64_t))
+			return 0;
+
+		std::vector<uint64_t> packed(words);
+		if (words)
+			memcpy(packed.data(), data + at, words * sizeof(uint64_t));
+		// every index has to point into the palette, or Get would read past it
+		if (bits != 0 and bits != DIRECT_BITS) {
+			int per = 64 / bits;
+			uint64_t mask = (1ull << bits) - 1;
+			for (int i = 0; i < Size; i++)
+				if (((packed[i / per] >> ((i % per) * bits)) & mask) >= count)
+					return 0;
+		}
+
+		Palette.resize(count);
+		for (size_t i = 0; i < count; i++)
+			Palette[i] = data[3 + 2*i] | data[4 + 2*i] << 8;
+		resize(bits);
+		Words = std::move(packed);
+		rebuildLookup();
+		return at + words * sizeof(uint64_t);
+	}
+
+private:
+	int perWord;
+	uint64_t valueMask;
+
+	// open addressing from BlockID to palette index + 1, 0 is an empty slot
+	std::vector<uint16_t> lookup;
+
+	static void put16(std::vector<uint8_t> &out, uint16_t v) {
+		out.push_back(v & 0xff);
+		out.push_back(v >> 8);
+	}
+
+	void resize(int bits) {
+		Bits = bits;
+		perWord = bits ? 64 / bits : 0;
+		valueMask = (1ull << bits) - 1;
+		Words.assign(bits ? (Size + perWord - 1) / perWord : 0, 0);
+	}
+
+	int find(BlockID id) const {
+		size_t mask = lookup.size() - 1;
+		for (size_t h = (id * 0x9e37u) & mask; lookup[h]; h = (h + 1) & mask)
+			if (Palette[lookup[h] - 1] == id)
+				return lookup[h] - 1;
+		return -1;
+	}
+
+	void rebuildLookup() {
+		lookup.assign(Bits == DIRECT_BITS ? 1 : 2 << Bits, 0);
+		if (Bits == DIRECT_BITS)
+			return;
+		size_t mask = lookup.size() - 1;
+		for (size_t i = 0; i < Palette.size(); i++) {
+			size_t h = (Palette[i] * 0x9e37u) & mask;
+			while (lookup[h])
+				h = (h + 1) & mask;
+			lookup[h] = i + 1;
+		}
+	}
+
+	// Appends id to the palette, doubling the width first if it's full
+	void add(BlockID id) {
+		if (Palette.size() == (1u << Bits))
+			grow(Bits == 8 ? DIRECT_BITS : Bits * 2);
+
+		if (Bits == DIRECT_BITS)
+			return;
+
+		Palette.push_back(id);
+		rebuildLookup();
+	}
+
+	void grow(int bits) {
+		std::vector<BlockID> values(Size);
+		for (int i = 0; i < Size; i++)
+			values[i] = Get(i);
+
+		resize(bits);
+		if (bits == DIRECT_BITS)
+			Palette.clear();
+
+		for (int i = 0; i < Size; i++) {
+			uint64_t value = bits == DIRECT_BITS ? values[i] : find(values[i]);
+			Words[i / perWord] |= value << ((i % perWord) * Bits);
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef PENDINGWRITES_H
+#define PENDINGWRITES_H
+
+#include <cstdint>
+#include <vector>
+
+#include "block.h"
+#include "chunkmap.h"
+#include "world.h"
+
+// A block generator code placed at world cube (X, Y, Z), outside the chunk
+// it was generating
+struct BlockWrite {
+	int X, Y, Z;
+	BlockID Block;
+};
+
+// Block writes waiting for the chunk they land in to be generated, queued
+// per chunk. Features near a chunk's edge spill into neighbours this way
+// instead of making them generate early.
+//
+// With a limit, only the queues of the limit most recently written chunks
+// are kept and the rest dropped, least recently written first.
+class PendingWrites {
+public:
+	// chunks with queued writes at most, 0 for no limit
+	PendingWrites(size_t maxChunks = 0) : maxChunks(maxChunks) {
+	}
+
+	void Add(const BlockWrite &write) {
+		uint64_t key = pack_chunk_coord(chunk_coord(write.X), chunk_coord(write.Y), chunk_coord(write.Z));
+		if (maxChunks and not queues.Find(key) and queues.Size() >= maxChunks)
+			evictOldest();
+		Queue &queue = queues.Insert(key);
+		queue.Writes.push_back(write);
+		queue.LastUsed = ++clock;
+		count++;
+	}
+
+	// Moves the writes queued for chunk (cx, cy, cz) to the end of out,
+	// returns false if there were none
+	bool Take(int cx, int cy, int cz, std::vector<BlockWrite> &out) {
+		uint64_t key = pack_chunk_coord(cx, cy, cz);
+		Queue *queue = queues.Find(key);
+		if (not queue)
+			return false;
+		out.insert(out.end(), queue->Writes.begin(), queue->Writes.end());
+		count -= queue->Writes.size();
+		queues.Erase(key);
+		return true;
+	}
+
+	// writes queued over all chunks
+	size_t Size() const {
+		return count;
+	}
+
+	// writes dropped to stay within the limit
+	size_t Dropped() const {
+		return dropped;
+	}
+
+private:
+	struct Queue {
+		std::vector<BlockWrite> Writes;
+		// value of clock when it was last added to
+		uint64_t LastUsed = 0;
+	};
+
+	ChunkMap<Queue> queues;
+	size_t maxChunks;
+	size_t count = 0;
+	size_t dropped = 0;
+	uint64_t clock = 0;
+
+	// like ClimateMap's cache, few enough queues that a scan beats keeping
+	// them in order
+	void evictOldest() {
+		uint64_t oldest = 0, oldestUse = UINT64_MAX;
+		queues.ForEach([&](uint64_t key, Queue &queue) {
+			if (queue.LastUsed < oldestUse) {
+				oldest = key;
+				oldestUse = queue.LastUsed;
+			}
+		});
+		size_t size = queues.Find(oldest)->Writes.size();
+		count -= size;
+		dropped += size;
+		queues.Erase(oldest);
+	}
+};
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+
+#include "dbgmsg.h"
+
+// CPU profiling zones, exported as Chrome trace JSON (chrome://tracing or
+// ui.perfetto.dev). Build with -DDUDUCRAFT_PROFILE to turn them on; without
+// it PROFILE_ZONE and PROFILE_THREAD expand to nothing.
+//
+//   void meshChunk() {
+//       PROFILE_ZONE("mesh chunk");
+//       ...
+//   }
+
+#ifdef DUDUCRAFT_PROFILE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+const bool PROFILING = true;
+
+// zones kept per thread, older ones are overwritten
+const size_t PROFILE_EVENTS_PER_THREAD = 1 << 16;
+
+// Fields are relaxed atomics, plain moves on x86, so the exporter may read
+// a slot while its thread overwrites it without that being a data race
+struct ProfileEvent {
+	std::atomic<const char*> Name;
+	std::atomic<uint64_t> Start, End;
+};
+
+// One thread's ring of finished zones. Only the owning thread writes; Head
+// is published with release once an event is whole. The exporter copies
+// the ring, then rereads Head and drops whatever the thread may have
+// started overwriting meanwhile.
+struct ProfileBuffer {
+	int Thread;
+	std::string Name;
+	std::atomic<uint64_t> Head{0};
+	ProfileEvent Events[PROFILE_EVENTS_PER_THREAD];
+};
+
+struct Profiler {
+	std::chrono::steady_clock::time_point Epoch = std::chrono::steady_clock::now();
+	// buffers live until exit, so zones of finished threads still export
+	std::mutex Mutex;
+	std::vector<std::unique_ptr<ProfileBuffer>> Buffers;
+};
+
+Profiler& profiler() {
+	static Profiler p;
+	return p;
+}
+
+// nanoseconds since the profiler started
+uint64_t profile_now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - profiler().Epoch).count();
+}
+
+// The calling thread's buffer, registered on first use; the only lock a
+// thread ever takes
+ProfileBuffer& profile_buffer() {
+	thread_local ProfileBuffer *buffer = nullptr;
+	if (not buffer) {
+		Profiler &p = profiler();
+		std::lock_guard<std::mutex> lock(p.Mutex);
+		p.Buffers.emplace_back(new ProfileBuffer());
+		buffer = p.Buffers.back().get();
+		buffer->Thread = p.Buffers.size();
+		buffer->Name = "thread " + std::to_string(buffer->Thread);
+	}
+	return *buffer;
+}
+
+void profile_thread_name(const char *name) {
+	profile_buffer().Name = name;
+}
+
+// Times its own lifetime. name must outlive the profiler, like a literal.
+class ProfileZone {
+public:
+	ProfileZone(const char *name) : name(name), start(profile_now()) {
+	}
+
+	~ProfileZone() {
+		ProfileBuffer &buffer = profile_buffer();
+		uint64_t end = profile_now();
+		uint64_t head = buffer.Head.load(std::memory_order_relaxed);
+		// an exporter that sees any of the stores below also sees Head
+		// at least at head, so it knows the slot's old event is going
+		std::atomic_thread_fence(std::memory_order_release);
+		ProfileEvent &e = buffer.Events[head % PROFILE_EVENTS_PER_THREAD];
+		e.Name.store(name, std::memory_order_relaxed);
+		e.Start.store(start, std::memory_order_relaxed);
+		e.End.store(end, std::memory_order_relaxed);
+		buffer.Head.store(head + 1, std::memory_order_release);
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	const char *name;
+	uint64_t start;
+};
+
+// Writes every thread's recorded zones to path as trace events
+bool profiler_write_trace(const std::string &path) {
+	FILE *file = fopen(path.c_str(), "w");
+	if (not file) {
+		print_failure("Failed to write profile trace to " + path);
+		return false;
+	}
+
+	auto escaped = [](const std::string &s) {
+		std::string out;
+		for (char c : s) {
+			if (c == '"' or c == '\\')
+				out += '\\';
+			out += c;
+		}
+		return out;
+	};
+
+	Profiler &p = profiler();
+	std::lock_guard<std::mutex> lock(p.Mutex);
+	size_t events = 0;
+	const char *separator = "";
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	for (const std::unique_ptr<ProfileBuffer> &buffer : p.Buffers) {
+		fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				separator, buffer->Thread, escaped(buffer->Name).c_str());
+		separator = ",";
+
+		struct Copy {
+			const char *Name;
+			uint64_t Start, End;
+		};
+		std::vector<Copy> copies;
+		uint64_t head = buffer->Head.load(std::memory_order_acquire);
+		uint64_t first = head > PROFILE_EVENTS_PER_THREAD ? head - PROFILE_EVENTS_PER_THREAD : 0;
+		for (uint64_t i = first; i < head; i++) {
+			const ProfileEvent &e = buffer->Events[i % PROFILE_EVENTS_PER_THREAD];
+			copies.push_back({ e.Name.load(std::memory_order_relaxed), e.Start.load(std::memory_order_relaxed),
+					e.End.load(std::memory_order_relaxed) });
+		}
+
+		// event i's slot is rewritten by event i + PROFILE_EVENTS_PER_THREAD,
+		// which may have begun once Head reached it
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t now = buffer->Head.load(std::memory_order_relaxed);
+		uint64_t intact = now >= PROFILE_EVENTS_PER_THREAD ? now - PROFILE_EVENTS_PER_THREAD + 1 : 0;
+		for (uint64_t i = std::max(first, intact); i < head; i++) {
+			const Copy &e = copies[i - first];
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+					escaped(e.Name).c_str(), buffer->Thread, e.Start / 1000.0, (e.End - e.Start) / 1000.0);
+			events++;
+		}
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+
+	print_success("Wrote " + std::to_string(events) + " profile zones to " + path);
+	return true;
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD(name) profile_thread_name(name)
+
+#else
+
+const bool PROFILING = false;
+
+bool profiler_write_trace(const std::string &) {
+	print_failure("Profiling is compiled out, build with -DDUDUCRAFT_PROFILE");
+	return false;
+}
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+
+#endif
+
+#endif
@@ -3,11 +3,17 @@
 
 #include <glad/glad.h>
 
+#include <sys/stat.h>
+
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
 
+#include <cstdint>
+#include <cstdio>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -28,27 +34,70 @@ void check_shader_compilation(unsigned int sid) {
 void check_program_link(unsigned int pid) {
 	int success; char infoLog[256];
 
-	glGetProgramiv(pid, GL_COMPILE_STATUS, &success);
+	glGetProgramiv(pid, GL_LINK_STATUS, &success);
 	if (!success) {
-		glGetShaderInfoLog(pid, 256, NULL, infoLog);
+		glGetProgramInfoLog(pid, 256, NULL, infoLog);
 		print_failure("Shader Program creation error (check infolog)");
 		print_infolog(infoLog);
 	} else print_success("Shader Program created succesfully");
 }
 
+// where linked programs are kept between runs, one file per program
+const char *SHADER_CACHE_DIR = "shader/cache";
+
+// glProgramBinary needs GL 4.1 (or ARB_get_program_binary) and a driver
+// with at least one binary format
+bool program_binaries_supported() {
+	if (not glProgramBinary or not glGetProgramBinary)
+		return false;
+	int formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+// FNV-1a, continuing from hash
+uint64_t fnv1a(const std::string &data, uint64_t hash = 14695981039346656037ull) {
+	for (unsigned char c : data) {
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
 class Shader {
 public:
 	unsigned int ID;
 
+	// active uniforms and uniform blocks by name, reflected once after
+	// linking; uniforms inside blocks have no location and aren't listed
+	std::unordered_map<std::string, int> Uniforms;
+	std::unordered_map<std::string, unsigned int> UniformBlocks;
+
 	Shader(const char* vertexPath, const char* fragmentPath);
 
 	void use();
 
+	// location of a uniform, -1 (which the setters ignore) if it isn't
+	// active; look it up once and use the location in hot loops
+	int Uniform(const std::string &name) const;
+
+	// Points the named uniform block at a GL_UNIFORM_BUFFER binding point
+	void BindUniformBlock(const std::string &name, unsigned int binding);
+
 	void setBool(const std::string &name, bool value) const;
 	void setInt(const std::string &name, int value) const;
 	void setFloat(const std::string &name, float value) const;
-	void setMat4(const std::string &name, glm::mat4 &mat) const;
-	void setVec3(const std::string &name, glm::vec3 &vec) const;
+	void setMat4(const std::string &name, const glm::mat4 &mat) const;
+	void setVec3(const std::string &name, const glm::vec3 &vec) const;
+
+	void setInt(int location, int value) const;
+	void setMat4(int location, const glm::mat4 &mat) const;
+
+private:
+	void reflect();
+
+	bool loadBinary(const std::string &path, uint64_t key);
+	void saveBinary(const std::string &path, uint64_t key);
 };
 
 Shader::Shader(const char* vertexPath, const char* fragmentPath) {
@@ -79,6 +128,27 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
 		print_failure("shader: file not successfully read");
 	}
 
+	// binaries only work with the driver that made them
+	bool cache = program_binaries_supported();
+	std::string cachePath;
+	uint64_t key = 0;
+	if (cache) {
+		key = fnv1a(vertexCode);
+		key = fnv1a(fragmentCode, key * 31);
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+			key = fnv1a((const char *)glGetString(name), key * 31);
+
+		char file[32];
+		snprintf(file, sizeof(file), "/%016llx.bin", (unsigned long long)key);
+		cachePath = SHADER_CACHE_DIR + std::string(file);
+
+		if (loadBinary(cachePath, key)) {
+			print_success("Loaded program binary from " + cachePath);
+			reflect();
+			return;
+		}
+	}
+
 	const char* vShaderCode = vertexCode.c_str();
 	const char* fShaderCode = fragmentCode.c_str();
 
@@ -97,35 +167,147 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
 	ID = glCreateProgram();
 	glAttachShader(ID, vertex);
 	glAttachShader(ID, fragment);
+	if (cache)
+		glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(ID);
 
 	check_program_link(ID);
 
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
+
+	if (cache)
+		saveBinary(cachePath, key);
+	reflect();
+}
+
+// Cache files hold a uint64 key and uint32 binary format, then the binary.
+// Returns false, leaving ID unset, when the file is missing, was made for
+// other sources or another driver, or the driver refuses it.
+bool Shader::loadBinary(const std::string &path, uint64_t key) {
+	FILE *file = fopen(path.c_str(), "rb");
+	if (not file)
+		return false;
+
+	uint64_t fileKey = 0;
+	uint32_t format = 0;
+	std::vector<char> binary;
+	bool read = fread(&fileKey, sizeof(fileKey), 1, file) == 1 and fread(&format, sizeof(format), 1, file) == 1;
+	if (read and fileKey == key) {
+		char buffer[4096];
+		size_t n;
+		while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			binary.insert(binary.end(), buffer, buffer + n);
+	}
+	fclose(file);
+	if (binary.empty())
+		return false;
+
+	ID = glCreateProgram();
+	glProgramBinary(ID, format, binary.data(), binary.size());
+
+	int success;
+	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	if (not success) {
+		glDeleteProgram(ID);
+		return false;
+	}
+	return true;
+}
+
+void Shader::saveBinary(const std::string &path, uint64_t key) {
+	int length = 0, success;
+	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (not success or length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLenum format;
+	glGetProgramBinary(ID, length, &length, &format, binary.data());
+
+	mkdir(SHADER_CACHE_DIR, 0755);
+	// written aside and renamed, so a crash never leaves half a binary
+	std::string temp = path + ".tmp";
+	FILE *file = fopen(temp.c_str(), "wb");
+	uint32_t format32 = format;
+	bool written = file and fwrite(&key, sizeof(key), 1, file) == 1
+		and fwrite(&format32, sizeof(format32), 1, file) == 1
+		and fwrite(binary.data(), 1, length, file) == (size_t)length;
+	if (file)
+		written = fclose(file) == 0 and written;
+	if (not written or rename(temp.c_str(), path.c_str()) != 0) {
+		remove(temp.c_str());
+		print_failure("Failed to write program binary to " + path);
+	}
+}
+
+void Shader::reflect() {
+	char name[256];
+	GLsizei length;
+	GLint size;
+	GLenum type;
+
+	int count = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+	for (int i = 0; i < count; i++) {
+		glGetActiveUniform(ID, i, sizeof(name), &length, &size, &type, name);
+		int loc = glGetUniformLocation(ID, name);
+		if (loc < 0)
+			continue;
+
+		// arrays are reported as "name[0]", accept the bare name too
+		std::string uniform(name, length);
+		Uniforms[uniform] = loc;
+		if (uniform.size() > 3 and uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+			Uniforms[uniform.substr(0, uniform.size() - 3)] = loc;
+	}
+
+	count = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+	for (int i = 0; i < count; i++) {
+		glGetActiveUniformBlockName(ID, i, sizeof(name), &length, name);
+		UniformBlocks[std::string(name, length)] = i;
+	}
 }
 
 void Shader::use() {
 	glUseProgram(ID);
 }
 
+int Shader::Uniform(const std::string &name) const {
+	auto found = Uniforms.find(name);
+	return found == Uniforms.end() ? -1 : found->second;
+}
+
+void Shader::BindUniformBlock(const std::string &name, unsigned int binding) {
+	auto found = UniformBlocks.find(name);
+	if (found != UniformBlocks.end())
+		glUniformBlockBinding(ID, found->second, binding);
+}
+
 void Shader::setBool(const std::string &name, bool value) const {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	glUniform1i(Uniform(name), (int)value);
 }
 void Shader::setInt(const std::string &name, int value) const {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	glUniform1i(Uniform(name), value);
 }
 void Shader::setFloat(const std::string &name, float value) const {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	glUniform1f(Uniform(name), value);
 }
-void Shader::setMat4(const std::string &name, glm::mat4 &mat) const {
-	int loc = glGetUniformLocation(ID, name.c_str());
-	glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(mat));
+void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const {
+	setMat4(Uniform(name), mat);
 }
 
-void Shader::setVec3(const std::string &name, glm::vec3 &vec) const {
-	int loc = glGetUniformLocation(ID, name.c_str());
-	glUniform3fv(loc, 1, glm::value_ptr(vec));
+void Shader::setVec3(const std::string &name, const glm::vec3 &vec) const {
+	glUniform3fv(Uniform(name), 1, glm::value_ptr(vec));
+}
+
+void Shader::setInt(int location, int value) const {
+	glUniform1i(location, value);
+}
+void Shader::setMat4(int location, const glm::mat4 &mat) const {
+	glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
 }
 
 #endif
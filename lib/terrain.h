@@ -0,0 +1,242 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "chunk.h"
+#include "climate.h"
+#include "density.h"
+#include "noise.h"
+#include "pendingwrites.h"
+
+// Whether a feature placing b over old wins. Trunks push leaves aside and
+// leaves only fill air, so overlapping trees come out the same whichever
+// grew first.
+bool feature_replaces(BlockID old, BlockID b) {
+	return old == BLOCK_AIR or (b == BLOCK_LOG and old == BLOCK_LEAVES);
+}
+
+// Rolling hills for any chunk of an endless world, the same every time for
+// the same seed. The hills come from a heightmap, which 3D noise bends into
+// overhangs, and the climate picks what covers them. Caves and trees are
+// separate steps, each needing only the chunk itself (see WorldGenerator).
+class TerrainGenerator {
+public:
+	uint32_t Seed;
+	FractalNoise Height, Detail, Caves;
+	// looked up by every chunk from every worker, it keeps its own cache
+	mutable ClimateMap Climate;
+	// cube y the surface swings around, and how far it swings either way
+	int BaseHeight = 8;
+	float Amplitude = 24.0f;
+	// cubes above or below the heightmap at which the ground's density has
+	// changed by one, against Detail's -1 .. 1; larger means more overhangs
+	float Squash = 6.0f;
+	// Caves noise above CaveThreshold is hollow, fading out within CaveRoof
+	// cubes of the heightmap so caves rarely break the surface
+	float CaveThreshold = 0.3f;
+	float CaveRoof = 6.0f;
+	// tries at a tree per chunk, each on a random column, growing with the
+	// chance its biome gives
+	int TreeAttempts = 6;
+
+	bool SIMD = noise_avx2_supported();
+
+	TerrainGenerator(uint32_t seed) : Seed(seed), Height(seed), Detail(seed ^ 0x5bd1e995), Caves(seed ^ 0x1b873593), Climate(seed) {
+		Detail.Octaves = 3;
+		Detail.Frequency = 1.0f / 24.0f;
+		Caves.Octaves = 2;
+		Caves.Frequency = 1.0f / 24.0f;
+	}
+
+	// turn off to force the scalar paths
+	void UseSIMD(bool simd) {
+		SIMD = Height.SIMD = Detail.SIMD = Caves.SIMD = simd;
+		Climate.Temperature.SIMD = Climate.Humidity.SIMD = simd;
+	}
+
+	// Surface height, the y of the first air cube, of every column of chunk
+	// column (cx, cz) before overhangs and caves, indexed [x][z] like
+	// Chunk(int height[16][16])
+	void Heightmap(int cx, int cz, int height[CHUNK_SIZE][CHUNK_SIZE]) const {
+		const int COLUMNS = CHUNK_SIZE * CHUNK_SIZE;
+		float x[COLUMNS], z[COLUMNS], noise[COLUMNS];
+		for (int i = 0; i < CHUNK_SIZE; i++) {
+			for (int j = 0; j < CHUNK_SIZE; j++) {
+				x[i * CHUNK_SIZE + j] = cx * CHUNK_SIZE + i;
+				z[i * CHUNK_SIZE + j] = cz * CHUNK_SIZE + j;
+			}
+		}
+		Height.Sample(x, z, COLUMNS, noise);
+
+		for (int i = 0; i < CHUNK_SIZE; i++)
+			for (int j = 0; j < CHUNK_SIZE; j++)
+				height[i][j] = BaseHeight + (int)floorf(noise[i * CHUNK_SIZE + j] * Amplitude);
+	}
+
+	// Samples the ground's density on the coarse lattice of chunk (cx, cy, cz)
+	void Lattice(int cx, int cy, int cz, DensityLattice lattice) const {
+		float columnX[LATTICE_COLUMNS], columnZ[LATTICE_COLUMNS], surface[LATTICE_COLUMNS];
+		for (int i = 0; i < LATTICE_COLUMNS; i++) {
+			columnX[i] = cx * CHUNK_SIZE + i % DENSITY_POINTS * DENSITY_STEP;
+			columnZ[i] = cz * CHUNK_SIZE + i / DENSITY_POINTS * DENSITY_STEP;
+		}
+		Height.Sample(columnX, columnZ, LATTICE_COLUMNS, surface);
+
+		float x[LATTICE_POINTS], y[LATTICE_POINTS], z[LATTICE_POINTS], detail[LATTICE_POINTS];
+		latticePoints(cx, cy, cz, x, y, z);
+		Detail.Sample(x, y, z, LATTICE_POINTS, detail);
+
+		for (int i = 0; i < LATTICE_POINTS; i++) {
+			float height = BaseHeight + surface[i % LATTICE_COLUMNS] * Amplitude;
+			latticeAt(lattice, i) = (height - y[i]) / Squash + detail[i];
+		}
+	}
+
+	// Terrain alone: the ground, covered the way each column's biome says
+	Chunk Generate(int cx, int cy, int cz) const {
+		DensityLattice lattice = {};
+		Lattice(cx, cy, cz, lattice);
+		DensityField density;
+		interpolate_density(lattice, density, SIMD);
+		ChunkClimate climate;
+		Climate.Columns(cx, cz, climate);
+
+		// the top solid cube of each column is the biome's surface, the
+		// next three its subsoil
+		BlockID blocks[CHUNK_VOLUME];
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			for (int x = 0; x < CHUNK_SIZE; x++) {
+				const Biome &biome = BIOMES[biome_at(climate[x][z])];
+				int depth = 0;
+				for (int y = DENSITY_HEIGHT - 1; y >= 0; y--) {
+					depth = density[y][z][x] > 0.0f ? depth + 1 : 0;
+					if (y >= CHUNK_SIZE)
+						continue;
+					BlockID &b = blocks[Chunk::Index(x, y, z)];
+					if (depth == 0)
+						b = BLOCK_AIR;
+					else if (depth == 1)
+						b = biome.Surface;
+					else if (depth <= 4)
+						b = biome.Subsoil;
+					else
+						b = BLOCK_STONE;
+				}
+			}
+		}
+
+		Chunk chunk(BLOCK_AIR);
+		chunk.SetBlocks(blocks);
+		chunk.X = cx; chunk.Y = cy; chunk.Z = cz;
+		return chunk;
+	}
+
+	// Hollows the caves out of chunk (cx, cy, cz), from a lattice like the
+	// ground's
+	void Carve(Chunk &chunk, int cx, int cy, int cz) const {
+		float x[LATTICE_POINTS], y[LATTICE_POINTS], z[LATTICE_POINTS], caves[LATTICE_POINTS], surface[LATTICE_COLUMNS];
+		latticePoints(cx, cy, cz, x, y, z);
+		Caves.Sample(x, y, z, LATTICE_POINTS, caves);
+		// the first layer of points are the columns
+		Height.Sample(x, z, LATTICE_COLUMNS, surface);
+
+		DensityLattice lattice = {};
+		for (int i = 0; i < LATTICE_POINTS; i++) {
+			float roof = y[i] - (BaseHeight + surface[i % LATTICE_COLUMNS] * Amplitude - CaveRoof);
+			latticeAt(lattice, i) = CaveThreshold - caves[i] + std::max(roof, 0.0f) / CaveRoof;
+		}
+		DensityField density;
+		interpolate_density(lattice, density, SIMD);
+
+		BlockID blocks[CHUNK_VOLUME];
+		bool carved = false;
+		for (int y = 0; y < CHUNK_SIZE; y++) {
+			for (int z = 0; z < CHUNK_SIZE; z++) {
+				for (int x = 0; x < CHUNK_SIZE; x++) {
+					BlockID &b = blocks[Chunk::Index(x, y, z)];
+					b = chunk.GetBlock(x, y, z);
+					if (b != BLOCK_AIR and density[y][z][x] <= 0.0f) {
+						b = BLOCK_AIR;
+						carved = true;
+					}
+				}
+			}
+		}
+		if (carved)
+			chunk.SetBlocks(blocks);
+	}
+
+	// Grows a few trees on the surface of chunk (cx, cy, cz). Blocks of trees
+	// reaching past the chunk go to outside, in world cubes, for whoever
+	// generates the chunks they land in.
+	void Decorate(Chunk &chunk, int cx, int cy, int cz, std::vector<BlockWrite> &outside) const {
+		auto place = [&](int x, int y, int z, BlockID b) {
+			if (x < 0 or x >= CHUNK_SIZE or y < 0 or y >= CHUNK_SIZE or z < 0 or z >= CHUNK_SIZE)
+				outside.push_back({ cx * CHUNK_SIZE + x, cy * CHUNK_SIZE + y, cz * CHUNK_SIZE + z, b });
+			else if (feature_replaces(chunk.GetBlock(x, y, z), b))
+				chunk.SetCube(x, y, z, b);
+		};
+
+		uint32_t h = (Seed ^ (uint32_t)cx * NOISE_PRIME_X ^ (uint32_t)cy * NOISE_PRIME_Y
+				^ (uint32_t)cz * NOISE_PRIME_Z) * NOISE_MIX | 1;
+		for (int t = 0; t < TreeAttempts; t++) {
+			h ^= h << 13; h ^= h >> 17; h ^= h << 5;
+			int x = h % CHUNK_SIZE, z = h / CHUNK_SIZE % CHUNK_SIZE, trunk = 4 + h / 256 % 3;
+			const Biome &biome = BIOMES[biome_at(Climate.At(cx * CHUNK_SIZE + x, cz * CHUNK_SIZE + z))];
+			if ((h >> 24) * (1.0f / 256.0f) >= biome.Trees)
+				continue;
+
+			// the ground always leaves air over its surface, so only this
+			// chunk's own trees can be in the way
+			int y = CHUNK_SIZE - 1;
+			while (y >= 0 and chunk.GetBlock(x, y, z) != biome.Surface)
+				y--;
+			if (y < 0 or (y + 1 < CHUNK_SIZE and chunk.GetBlock(x, y + 1, z) != BLOCK_AIR))
+				continue;
+
+			for (int i = 1; i <= trunk; i++)
+				place(x, y + i, z, BLOCK_LOG);
+			// two wide layers around the top of the trunk, two narrow ones above
+			for (int i = trunk - 1; i <= trunk + 2; i++) {
+				int r = i <= trunk ? 2 : 1;
+				for (int dz = -r; dz <= r; dz++)
+					for (int dx = -r; dx <= r; dx++)
+						if (abs(dx) != r or abs(dz) != r)
+							place(x + dx, y + i, z + dz, BLOCK_LEAVES);
+			}
+		}
+	}
+
+	// Applies writes other chunks' features left for chunk (cx, cy, cz)
+	void Place(Chunk &chunk, int cx, int cy, int cz, const std::vector<BlockWrite> &writes) const {
+		for (const BlockWrite &w : writes) {
+			int x = w.X - cx * CHUNK_SIZE, y = w.Y - cy * CHUNK_SIZE, z = w.Z - cz * CHUNK_SIZE;
+			if (feature_replaces(chunk.GetBlock(x, y, z), w.Block))
+				chunk.SetCube(x, y, z, w.Block);
+		}
+	}
+
+private:
+	static const int LATTICE_COLUMNS = DENSITY_POINTS * DENSITY_POINTS;
+	static const int LATTICE_POINTS = LATTICE_COLUMNS * DENSITY_POINTS_Y;
+
+	// world position of each lattice point of chunk (cx, cy, cz), x fastest
+	void latticePoints(int cx, int cy, int cz, float *x, float *y, float *z) const {
+		for (int i = 0; i < LATTICE_POINTS; i++) {
+			x[i] = cx * CHUNK_SIZE + i % DENSITY_POINTS * DENSITY_STEP;
+			y[i] = cy * CHUNK_SIZE + i / LATTICE_COLUMNS * DENSITY_STEP;
+			z[i] = cz * CHUNK_SIZE + i % LATTICE_COLUMNS / DENSITY_POINTS * DENSITY_STEP;
+		}
+	}
+
+	static float& latticeAt(DensityLattice lattice, int i) {
+		return lattice[i / LATTICE_COLUMNS][i % LATTICE_COLUMNS / DENSITY_POINTS][i % DENSITY_POINTS];
+	}
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "profiler.h"
+
+// Fixed set of worker threads running jobs in submission order. Jobs still
+// queued when the pool is destroyed are dropped; running ones are waited for.
+class ThreadPool {
+public:
+	// defaults to one worker per core, leaving one for the render thread
+	ThreadPool(int threads = std::max(1, (int)std::thread::hardware_concurrency() - 1)) {
+		for (int i = 0; i < threads; i++)
+			workers.emplace_back([this] { run(); });
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread &t : workers)
+			t.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Submit(std::function<void()> job) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(std::move(job));
+		}
+		wake.notify_one();
+	}
+
+	// Blocks until every job submitted so far has finished
+	void Wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [this] { return jobs.empty() and running == 0; });
+	}
+
+	int Threads() const { return workers.size(); }
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable wake, idle;
+	int running = 0;
+	bool stopping = false;
+
+	void run() {
+		PROFILE_THREAD("worker");
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this] { return stopping or not jobs.empty(); });
+				if (stopping)
+					return;
+				job = std::move(jobs.front());
+				jobs.pop_front();
+				running++;
+			}
+			job();
+
+			std::lock_guard<std::mutex> lock(mutex);
+			running--;
+			if (jobs.empty() and running == 0)
+				idle.notify_all();
+		}
+	}
+};
+
+// Lock-free multiple producer, single consumer queue (Vyukov). Producers
+// never wait on each other or on the consumer; Pop may briefly miss an item
+// whose Push is still in progress.
+template <typename T>
+class MPSCQueue {
+public:
+	MPSCQueue() {
+		Node *stub = new Node();
+		head.store(stub);
+		tail = stub;
+	}
+
+	~MPSCQueue() {
+		T value;
+		while (Pop(value))
+			;
+		delete tail;
+	}
+
+	MPSCQueue(const MPSCQueue&) = delete;
+	MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+	void Push(T value) {
+		Node *node = new Node();
+		node->Value = std::move(value);
+		Node *prev = head.exchange(node, std::memory_order_acq_rel);
+		prev->Next.store(node, std::memory_order_release);
+	}
+
+	// consumer thread only
+	bool Pop(T &out) {
+		Node *next = tail->Next.load(std::memory_order_acquire);
+		if (not next)
+			return false;
+		out = std::move(next->Value);
+		delete tail;
+		tail = next;
+		return true;
+	}
+
+private:
+	struct Node {
+		std::atomic<Node*> Next{nullptr};
+		T Value;
+	};
+
+	std::atomic<Node*> head;
+	Node *tail;
+};
+
+#endif
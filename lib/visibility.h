@@ -0,0 +1,87 @@
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "chunk.h"
+#include "mesher.h"
+
+// Which faces of a chunk can see each other through its air: bit a*6 + b is
+// set when faces a and b (numbered like Face) are joined by a path of air
+// cubes inside the chunk
+typedef uint64_t FaceConnectivity;
+
+const FaceConnectivity ALL_FACES_CONNECTED = (1ull << 36) - 1;
+
+bool faces_connected(FaceConnectivity c, int a, int b) {
+	return (c >> (a * 6 + b)) & 1;
+}
+
+// Flood fills the chunk's air from its border; every region of air joins
+// all the faces it touches. Only looks inside the chunk, not at its padding.
+FaceConnectivity chunk_face_connectivity(const MeshInput &chunk) {
+	if (chunk.Empty)
+		return ALL_FACES_CONNECTED;
+	if (chunk.Buried)
+		return 0;
+
+	const int CS = CHUNK_SIZE;
+	std::vector<bool> seen(CHUNK_VOLUME);
+	std::vector<int> stack;
+	FaceConnectivity result = 0;
+
+	auto faces_of = [](int x, int y, int z) {
+		int faces = 0;
+		if (x == CS - 1) faces |= 1 << FACE_POS_X;
+		if (x == 0)      faces |= 1 << FACE_NEG_X;
+		if (y == CS - 1) faces |= 1 << FACE_POS_Y;
+		if (y == 0)      faces |= 1 << FACE_NEG_Y;
+		if (z == CS - 1) faces |= 1 << FACE_POS_Z;
+		if (z == 0)      faces |= 1 << FACE_NEG_Z;
+		return faces;
+	};
+
+	for (int y = 0; y < CS; y++) {
+		for (int z = 0; z < CS; z++) {
+			for (int x = 0; x < CS; x++) {
+				int start = Chunk::Index(x, y, z);
+				if (not faces_of(x, y, z) or seen[start] or not chunk.IsAir(x, y, z))
+					continue;
+
+				int touched = 0;
+				seen[start] = true;
+				stack.push_back(start);
+				while (not stack.empty()) {
+					int i = stack.back();
+					stack.pop_back();
+					int cx = i % CS, cz = (i / CS) % CS, cy = i / (CS * CS);
+					touched |= faces_of(cx, cy, cz);
+
+					const int offsets[6][3] = {
+						{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+					};
+					for (const int *o : offsets) {
+						int nx = cx + o[0], ny = cy + o[1], nz = cz + o[2];
+						if (nx < 0 or ny < 0 or nz < 0 or nx >= CS or ny >= CS or nz >= CS)
+							continue;
+						int n = Chunk::Index(nx, ny, nz);
+						if (seen[n] or not chunk.IsAir(nx, ny, nz))
+							continue;
+						seen[n] = true;
+						stack.push_back(n);
+					}
+				}
+
+				for (int a = 0; a < 6; a++)
+					if (touched & (1 << a))
+						for (int b = 0; b < 6; b++)
+							if (touched & (1 << b))
+								result |= 1ull << (a * 6 + b);
+			}
+		}
+	}
+	return result;
+}
+
+#endif
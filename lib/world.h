@@ -0,0 +1,118 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <memory>
+
+#include "block.h"
+#include "chunk.h"
+#include "chunkmap.h"
+
+const int CHUNK_BITS = 4;
+static_assert(1 << CHUNK_BITS == CHUNK_SIZE, "CHUNK_BITS must match CHUNK_SIZE");
+
+// chunk holding world cube coordinate w, rounding towards -infinity
+int chunk_coord(int w) { return w >> CHUNK_BITS; }
+// position of world cube coordinate w inside its chunk
+int local_coord(int w) { return w & (CHUNK_SIZE - 1); }
+
+// All loaded chunks, keyed by chunk coordinate. World cube (x, y, z) is cube
+// (local_coord(x), ...) of chunk (chunk_coord(x), ...), in the same block
+// space the meshers use.
+class World {
+public:
+	ChunkMap<std::unique_ptr<Chunk>> Chunks;
+
+	Chunk* GetChunk(int cx, int cy, int cz) {
+		std::unique_ptr<Chunk> *chunk = Chunks.Find(pack_chunk_coord(cx, cy, cz));
+		return chunk ? chunk->get() : nullptr;
+	}
+
+	// Creates the chunk filled with fill, or returns it if it's already loaded
+	Chunk& CreateChunk(int cx, int cy, int cz, BlockID fill = BLOCK_AIR) {
+		std::unique_ptr<Chunk> &chunk = Chunks.Insert(pack_chunk_coord(cx, cy, cz));
+		if (not chunk) {
+			chunk.reset(new Chunk(fill));
+			chunk->X = cx; chunk->Y = cy; chunk->Z = cz;
+			dirtyNeighbours(cx, cy, cz);
+		}
+		return *chunk;
+	}
+
+	// Loads a copy of chunk at (cx, cy, cz), replacing whatever was there
+	Chunk& SetChunk(int cx, int cy, int cz, const Chunk &chunk) {
+		return SetChunk(cx, cy, cz, std::unique_ptr<Chunk>(new Chunk(chunk)));
+	}
+
+	Chunk& SetChunk(int cx, int cy, int cz, std::unique_ptr<Chunk> chunk) {
+		std::unique_ptr<Chunk> &slot = Chunks.Insert(pack_chunk_coord(cx, cy, cz));
+		slot = std::move(chunk);
+		slot->X = cx; slot->Y = cy; slot->Z = cz;
+		slot->MarkDirty();
+		dirtyNeighbours(cx, cy, cz);
+		return *slot;
+	}
+
+	void RemoveChunk(int cx, int cy, int cz) {
+		if (Chunks.Erase(pack_chunk_coord(cx, cy, cz)))
+			dirtyNeighbours(cx, cy, cz);
+	}
+
+	// cubes in chunks that aren't loaded are air
+	BlockID GetBlock(int x, int y, int z) {
+		Chunk *chunk = GetChunk(chunk_coord(x), chunk_coord(y), chunk_coord(z));
+		if (not chunk)
+			return BLOCK_AIR;
+		return chunk->GetBlock(local_coord(x), local_coord(y), local_coord(z));
+	}
+
+	// Writes to chunks that aren't loaded are dropped. The sections of
+	// neighbouring chunks that show this cube in their mesh are marked dirty
+	// as well.
+	void SetBlock(int x, int y, int z, BlockID b) {
+		int cx = chunk_coord(x), cy = chunk_coord(y), cz = chunk_coord(z);
+		Chunk *chunk = GetChunk(cx, cy, cz);
+		if (not chunk)
+			return;
+
+		int lx = local_coord(x), ly = local_coord(y), lz = local_coord(z);
+		chunk->SetCube(lx, ly, lz, b);
+
+		// neighbours on each axis whose border holds this cube
+		auto lo = [](int l) { return l == 0 ? -1 : 0; };
+		auto hi = [](int l) { return l == CHUNK_SIZE - 1 ? 1 : 0; };
+		for (int dy = lo(ly); dy <= hi(ly); dy++) {
+			for (int dz = lo(lz); dz <= hi(lz); dz++) {
+				for (int dx = lo(lx); dx <= hi(lx); dx++) {
+					Chunk *n = GetChunk(cx + dx, cy + dy, cz + dz);
+					if (n)
+						n->MarkDirty(ly - dy * CHUNK_SIZE);
+				}
+			}
+		}
+	}
+
+	// Fills out with the 3x3x3 chunks around (cx, cy, cz), in the order
+	// MeshInput expects; chunks that aren't loaded are nullptr
+	void Neighbourhood(int cx, int cy, int cz, const Chunk *out[27]) {
+		for (int dy = -1; dy <= 1; dy++)
+			for (int dz = -1; dz <= 1; dz++)
+				for (int dx = -1; dx <= 1; dx++)
+					out[(dy + 1) * 9 + (dz + 1) * 3 + (dx + 1)] = GetChunk(cx + dx, cy + dy, cz + dz);
+	}
+
+private:
+	// loading or unloading a chunk changes what its neighbours' borders see
+	void dirtyNeighbours(int cx, int cy, int cz) {
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dz = -1; dz <= 1; dz++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					Chunk *n = GetChunk(cx + dx, cy + dy, cz + dz);
+					if (n)
+						n->MarkDirty();
+				}
+			}
+		}
+	}
+};
+
+#endif
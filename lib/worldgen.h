@@ -0,0 +1,230 @@
+#ifndef WORLDGEN_H
+#define WORLDGEN_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "chunk.h"
+#include "chunkmap.h"
+#include "pendingwrites.h"
+#include "profiler.h"
+#include "terrain.h"
+#include "threadpool.h"
+#include "world.h"
+
+// What a chunk has been through so far, in order
+enum GenStage {
+	STAGE_NONE,
+	STAGE_TERRAIN,	// ground, grass and dirt
+	STAGE_CARVE,	// caves
+	STAGE_DECORATE,	// trees, which may spill into the neighbours
+	// Takes the blocks the neighbours' trees left for the chunk, compacts
+	// its storage and hands it to the world. Lighting belongs here once
+	// there is any.
+	STAGE_FINISH,
+};
+
+// queues of writes for chunks nobody has requested yet kept at most
+const size_t GEN_STRAY_CHUNKS = 1024;
+
+// Generates requested chunks on a shared thread pool, moving each through the
+// stages in order and handing it to the world when it's finished.
+//
+// Every stage needs only the chunk itself, so a request never pulls in its
+// neighbours and only requested chunks are generated, each by one job
+// running its stages back to back. Blocks that trees place past their chunk
+// wait in a queue for the chunk they land in: they join it at STAGE_FINISH,
+// or go straight into the world if it's already there. Update only submits
+// and collects, it never waits.
+//
+// Trees at the edge of the requested area spill into chunks nobody asked
+// for. Those writes are kept for the GEN_STRAY_CHUNKS most recently written
+// chunks and dropped past that, so the queues stay bounded while exploring;
+// a tree overhanging a chunk that's requested after its writes were
+// dropped is cut at the chunk's edge.
+class WorldGenerator {
+public:
+	TerrainGenerator Terrain;
+
+	// how many chunks were handed to the world by the last Update
+	int ChunksFinished = 0;
+
+	// pool is shared with the renderer and has to outlive the generator
+	WorldGenerator(uint32_t seed, ThreadPool &pool) : Terrain(seed), strays(GEN_STRAY_CHUNKS), pool(pool) {
+	}
+
+	// the jobs still queued point at this
+	~WorldGenerator() {
+		pool.Wait();
+	}
+
+	WorldGenerator(const WorldGenerator&) = delete;
+	WorldGenerator& operator=(const WorldGenerator&) = delete;
+
+	// Generates chunk (cx, cy, cz) up to the world. Chunks requested first
+	// go first, so request the nearest ones first.
+	void Request(int cx, int cy, int cz) {
+		uint64_t key = pack_chunk_coord(cx, cy, cz);
+		if (chunks.Find(key))
+			return;
+		chunks.Insert(key);
+		requested.push_back(key);
+		pending++;
+
+		std::vector<BlockWrite> early;
+		strays.Take(cx, cy, cz, early);
+		std::lock_guard<std::mutex> lock(writesMutex);
+		for (const BlockWrite &w : early)
+			writes.Add(w);
+	}
+
+	// requested chunks that aren't in the world yet
+	size_t Pending() const {
+		return pending;
+	}
+
+	// blocks waiting for chunks that aren't generated yet
+	size_t QueuedWrites() const {
+		std::lock_guard<std::mutex> lock(writesMutex);
+		return writes.Size() + strays.Size();
+	}
+
+	// blocks dropped for chunks nobody requested in time
+	size_t DroppedWrites() const {
+		return strays.Dropped();
+	}
+
+	// Gives finished chunks to world and submits the chunks requested
+	// since the last call
+	void Update(World &world) {
+		PROFILE_ZONE("worldgen update");
+		ChunksFinished = 0;
+
+		Done done;
+		while (finished.Pop(done)) {
+			pending--;
+			for (const BlockWrite &w : done.Writes)
+				place(world, w);
+
+			int cx, cy, cz;
+			unpack_chunk_coord(done.Key, cx, cy, cz);
+			world.SetChunk(cx, cy, cz, std::move(chunks.Find(done.Key)->C));
+			ChunksFinished++;
+
+			// left by trees that grew while the chunk was finishing
+			std::vector<BlockWrite> late;
+			{
+				std::lock_guard<std::mutex> lock(writesMutex);
+				writes.Take(cx, cy, cz, late);
+			}
+			for (const BlockWrite &w : late)
+				place(world, w);
+		}
+
+		for (uint64_t key : requested)
+			start(key);
+		requested.clear();
+	}
+
+private:
+	struct GenChunk {
+		// nullptr until its job starts and once it's in the world
+		std::unique_ptr<Chunk> C;
+	};
+
+	struct Done {
+		uint64_t Key;
+		// blocks the stages placed outside the chunk
+		std::vector<BlockWrite> Writes;
+	};
+
+	// every chunk ever requested; finished ones stay so they aren't generated twice
+	ChunkMap<GenChunk> chunks;
+	// requested since the last Update, not submitted yet
+	std::vector<uint64_t> requested;
+	size_t pending = 0;
+
+	// writes for requested chunks, taken when they finish; the workers
+	// take them too
+	mutable std::mutex writesMutex;
+	PendingWrites writes;
+	// writes for chunks nobody has requested, until someone does
+	PendingWrites strays;
+
+	MPSCQueue<Done> finished;
+	ThreadPool &pool;
+
+	// Puts w into the world if its chunk is there, or queues it for when
+	// it's generated
+	void place(World &world, const BlockWrite &w) {
+		int cx = chunk_coord(w.X), cy = chunk_coord(w.Y), cz = chunk_coord(w.Z);
+		if (not world.GetChunk(cx, cy, cz)) {
+			if (chunks.Find(pack_chunk_coord(cx, cy, cz))) {
+				std::lock_guard<std::mutex> lock(writesMutex);
+				writes.Add(w);
+			} else {
+				strays.Add(w);
+			}
+			return;
+		}
+		if (feature_replaces(world.GetBlock(w.X, w.Y, w.Z), w.Block))
+			world.SetBlock(w.X, w.Y, w.Z, w.Block);
+	}
+
+	// Submits one job that takes the chunk through every stage. No stage
+	// waits on the neighbours, so each follows the last right on the worker
+	// instead of waiting for the next Update.
+	void start(uint64_t key) {
+		int cx, cy, cz;
+		unpack_chunk_coord(key, cx, cy, cz);
+		GenChunk &gc = *chunks.Find(key);
+		gc.C.reset(new Chunk(BLOCK_AIR));
+
+		Chunk *chunk = gc.C.get();
+		pool.Submit([this, key, cx, cy, cz, chunk] {
+			Done done;
+			done.Key = key;
+			for (int stage = STAGE_TERRAIN; stage <= STAGE_FINISH; stage++)
+				run((GenStage)stage, *chunk, cx, cy, cz, done.Writes);
+			finished.Push(std::move(done));
+		});
+	}
+
+	// Runs one stage of chunk (cx, cy, cz) on a worker
+	void run(GenStage stage, Chunk &chunk, int cx, int cy, int cz, std::vector<BlockWrite> &outside) {
+		switch (stage) {
+		case STAGE_TERRAIN: {
+			PROFILE_ZONE("generate terrain");
+			chunk = Terrain.Generate(cx, cy, cz);
+			break;
+		}
+		case STAGE_CARVE: {
+			PROFILE_ZONE("carve caves");
+			Terrain.Carve(chunk, cx, cy, cz);
+			break;
+		}
+		case STAGE_DECORATE: {
+			PROFILE_ZONE("decorate");
+			Terrain.Decorate(chunk, cx, cy, cz, outside);
+			break;
+		}
+		case STAGE_FINISH: {
+			PROFILE_ZONE("finish chunk");
+			// everything arriving later goes in once it's in the world
+			std::vector<BlockWrite> incoming;
+			{
+				std::lock_guard<std::mutex> lock(writesMutex);
+				writes.Take(cx, cy, cz, incoming);
+			}
+			Terrain.Place(chunk, cx, cy, cz, incoming);
+			chunk.Compact();
+			break;
+		}
+		default:
+			break;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,411 @@
+#ifndef WORLDRENDERER_H
+#define WORLDRENDERER_H
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "chunkmap.h"
+#include "chunkmesh.h"
+#include "frustum.h"
+#include "instancedchunk.h"
+#include "mesher.h"
+#include "profiler.h"
+#include "shader.h"
+#include "threadpool.h"
+#include "visibility.h"
+#include "world.h"
+
+// What the last WorldRenderer::Draw did
+struct FrameStats {
+	int Chunks = 0;
+	int FrustumCulled = 0;
+	int OcclusionCulled = 0;
+	int DrawCalls = 0;
+	int Triangles = 0;
+};
+
+// How chunks get drawn: as meshes, or as one cube instance per visible
+// block (which needs shader/instanced.vert)
+enum RenderPath {
+	RENDER_MESHES,
+	RENDER_INSTANCED,
+};
+
+// Render state of one loaded chunk. Only one of Mesh and Instances is set,
+// depending on the RenderPath; chunks with nothing to draw have neither but
+// still take part in occlusion culling.
+struct RenderChunk {
+	std::unique_ptr<ChunkMesh> Mesh;
+	std::unique_ptr<InstancedChunk> Instances;
+	FaceConnectivity Connectivity = ALL_FACES_CONNECTED;
+
+	// the latest meshing job for the whole chunk and for each section;
+	// results of older ones are dropped
+	uint64_t Version = 0;
+	uint64_t SectionVersions[CHUNK_SECTIONS] = {};
+	uint64_t ConnectivityVersion = 0;
+
+	// position in the draw list, -1 with nothing to draw
+	int ListIndex = -1;
+	// last Draw that reached this chunk during occlusion culling
+	int Visited = 0;
+};
+
+// What a meshing job hands back to the render thread. Meshes only hold the
+// sections in the Sections mask; instances always cover the whole chunk.
+struct MeshResult {
+	uint64_t Key = 0;
+	uint64_t Version = 0;
+	RenderPath Path = RENDER_MESHES;
+	uint32_t Sections = 0;
+	MeshData Data[CHUNK_SECTIONS];
+	std::vector<CubeInstance> Instances;
+	FaceConnectivity Connectivity = ALL_FACES_CONNECTED;
+	float Microseconds = 0.0f;
+
+	int Vertices() const {
+		int count = Instances.size() * 36;
+		for (const MeshData &data : Data)
+			count += data.Vertices.size();
+		return count;
+	}
+
+	size_t Bytes() const {
+		size_t bytes = Instances.size() * sizeof(CubeInstance);
+		for (const MeshData &data : Data)
+			bytes += data.Vertices.size() * sizeof(ChunkVertex);
+		return bytes;
+	}
+};
+
+// Keeps a ChunkMesh for every chunk of a World that has something to draw.
+// Meshes are built on a pool of worker threads from snapshots of the chunks
+// and uploaded on the render thread a few at a time.
+class WorldRenderer {
+public:
+	ChunkMap<RenderChunk> Chunks;
+	MeshMode Mode = MESH_BINARY;
+	RenderPath Path = RENDER_MESHES;
+	bool OcclusionCulling = true;
+
+	// bytes of vertex data uploaded per Update, at least one chunk is always
+	// uploaded
+	size_t UploadBudget = 4 << 20;
+
+	FrameStats Stats;
+
+	// what the last Update uploaded, and how long the workers took to mesh it
+	int ChunksMeshed = 0;
+	int VerticesMeshed = 0;
+	float MeshMicroseconds = 0.0f;
+	// meshing jobs submitted but not uploaded yet
+	int Pending = 0;
+
+	// pool is shared with whatever else runs jobs, like the world
+	// generator, and has to outlive the renderer
+	WorldRenderer(ThreadPool &pool) : pool(pool) {
+	}
+
+	// the meshing jobs still queued point at this
+	~WorldRenderer() {
+		pool.Wait();
+	}
+
+	WorldRenderer(const WorldRenderer&) = delete;
+	WorldRenderer& operator=(const WorldRenderer&) = delete;
+
+	// Queues the sections that changed since the last call for meshing, or
+	// everything if the mode or path changed, uploads finished meshes within
+	// UploadBudget and drops the meshes of unloaded chunks. Returns whether
+	// anything was uploaded.
+	bool Update(World &world, MeshMode mode, RenderPath path = RENDER_MESHES) {
+		PROFILE_ZONE("renderer update");
+		bool remeshAll = mode != Mode or path != Path;
+		Mode = mode;
+		Path = path;
+
+		world.Chunks.ForEach([&](uint64_t key, std::unique_ptr<Chunk> &chunk) {
+			RenderChunk *rc = Chunks.Find(key);
+			if (rc and not chunk->IsDirty() and not remeshAll)
+				return;
+			PROFILE_ZONE("queue meshing");
+
+			// new chunks and instances, which can't be patched, redo the lot
+			uint32_t sections = chunk->DirtySections;
+			if (not rc or remeshAll or path == RENDER_INSTANCED)
+				sections = ALL_SECTIONS;
+			if (not rc) {
+				// inserting may move every RenderChunk
+				rc = &Chunks.Insert(key);
+				listDirty = true;
+			}
+			uint64_t version = ++lastVersion;
+			rc->Version = version;
+			for (int s = 0; s < CHUNK_SECTIONS; s++)
+				if (sections & (1u << s))
+					rc->SectionVersions[s] = version;
+			chunk->DirtySections = 0;
+
+			// the snapshot is all the job gets to see, so the world is free
+			// to change while it runs
+			const Chunk *neighbourhood[27];
+			world.Neighbourhood(chunk->X, chunk->Y, chunk->Z, neighbourhood);
+			std::shared_ptr<const MeshInput> input = std::make_shared<MeshInput>(neighbourhood);
+
+			Pending++;
+			pool.Submit([this, input, key, version, sections, mode, path] {
+				PROFILE_ZONE("mesh chunk");
+				auto start = std::chrono::steady_clock::now();
+				MeshResult result;
+				result.Key = key;
+				result.Version = version;
+				result.Path = path;
+				result.Sections = sections;
+				if (path == RENDER_INSTANCED) {
+					result.Instances = chunk_cube_instances(*input);
+				} else {
+					for (int s = 0; s < CHUNK_SECTIONS; s++)
+						if (sections & (1u << s))
+							result.Data[s] = mesh_chunk(*input, mode, s * SECTION_HEIGHT, (s + 1) * SECTION_HEIGHT);
+				}
+				result.Connectivity = chunk_face_connectivity(*input);
+				auto end = std::chrono::steady_clock::now();
+				result.Microseconds = std::chrono::duration<float, std::micro>(end - start).count();
+				results.Push(std::move(result));
+			});
+		});
+
+		std::vector<uint64_t> unloaded;
+		Chunks.ForEach([&](uint64_t key, RenderChunk &) {
+			if (not world.Chunks.Find(key))
+				unloaded.push_back(key);
+		});
+		for (uint64_t key : unloaded)
+			Chunks.Erase(key);
+		if (not unloaded.empty())
+			listDirty = true;
+
+		ChunksMeshed = 0;
+		VerticesMeshed = 0;
+		MeshMicroseconds = 0.0f;
+
+		size_t uploaded = 0;
+		MeshResult result;
+		while (uploaded < UploadBudget and results.Pop(result)) {
+			Pending--;
+			PROFILE_ZONE("upload");
+			RenderChunk *rc = Chunks.Find(result.Key);
+			// unloaded, or remeshed again since
+			if (not rc or not upload(*rc, result))
+				continue;
+
+			uploaded += result.Bytes();
+			ChunksMeshed++;
+			VerticesMeshed += result.Vertices();
+			MeshMicroseconds += result.Microseconds;
+		}
+
+		return ChunksMeshed > 0;
+	}
+
+	// Draws the chunks inside the view frustum of projection * view and, with
+	// OcclusionCulling on, only those the camera could see through air. The
+	// shader must match Path.
+	void Draw(Shader &shader, const glm::mat4 &projectionView, glm::vec3 cameraPosition) {
+		PROFILE_ZONE("renderer draw");
+		if (listDirty) {
+			drawList.clear();
+			bounds.Clear();
+			Chunks.ForEach([&](uint64_t, RenderChunk &rc) {
+				rc.ListIndex = -1;
+				if (rc.Mesh) {
+					bounds.Add(rc.Mesh->BoundsMin, rc.Mesh->BoundsMax);
+				} else if (rc.Instances) {
+					bounds.Add(rc.Instances->BoundsMin, rc.Instances->BoundsMax);
+				} else {
+					return;
+				}
+				rc.ListIndex = drawList.size();
+				drawList.push_back(&rc);
+			});
+			listDirty = false;
+		}
+
+		Frustum frustum(projectionView);
+		int inside;
+		{
+			PROFILE_ZONE("frustum cull");
+			inside = frustum.Cull(bounds, visible);
+		}
+
+		Stats = FrameStats();
+		Stats.Chunks = drawList.size();
+		Stats.FrustumCulled = Stats.Chunks - inside;
+
+		if (OcclusionCulling and occlusionCull(frustum, cameraPosition))
+			Stats.OcclusionCulled = inside - reachedCount;
+
+		PROFILE_ZONE("draw submission");
+		int model = shader.Uniform("model");
+		for (size_t i = 0; i < drawList.size(); i++) {
+			if (not visible[i])
+				continue;
+			RenderChunk *rc = drawList[i];
+			if (rc->Mesh) {
+				shader.setMat4(model, rc->Mesh->Model);
+				rc->Mesh->Draw();
+				Stats.Triangles += rc->Mesh->VertexCount / 3;
+			} else {
+				shader.setMat4(model, rc->Instances->Model);
+				rc->Instances->Draw();
+				Stats.Triangles += rc->Instances->InstanceCount * 12;
+			}
+			Stats.DrawCalls++;
+		}
+	}
+
+private:
+	// chunks with something to draw and their bounds, rebuilt only when a
+	// mesh comes or goes
+	std::vector<RenderChunk*> drawList;
+	BoxList bounds;
+	std::vector<uint8_t> visible;
+	bool listDirty = true;
+
+	int frame = 0;
+	int reachedCount = 0;
+
+	uint64_t lastVersion = 0;
+	MPSCQueue<MeshResult> results;
+	ThreadPool &pool;
+
+	// Applies the parts of result that are still current, returns false if
+	// there were none
+	bool upload(RenderChunk &rc, const MeshResult &result) {
+		uint32_t current = 0;
+		if (result.Path == RENDER_INSTANCED) {
+			if (rc.Version != result.Version)
+				return false;
+		} else {
+			for (int s = 0; s < CHUNK_SECTIONS; s++)
+				if (result.Sections & (1u << s) and rc.SectionVersions[s] == result.Version)
+					current |= 1u << s;
+			if (not current)
+				return false;
+		}
+
+		int cx, cy, cz;
+		unpack_chunk_coord(result.Key, cx, cy, cz);
+		bool hadDrawable = rc.Mesh or rc.Instances;
+		if (result.Version > rc.ConnectivityVersion) {
+			rc.Connectivity = result.Connectivity;
+			rc.ConnectivityVersion = result.Version;
+		}
+
+		if (result.Path == RENDER_INSTANCED) {
+			rc.Mesh.reset();
+			if (result.Instances.empty()) {
+				rc.Instances.reset();
+			} else {
+				if (not rc.Instances)
+					rc.Instances.reset(new InstancedChunk());
+				rc.Instances->Model = Chunk::ModelMatrixAt(cx, cy, cz);
+				rc.Instances->Upload(result.Instances);
+			}
+		} else {
+			rc.Instances.reset();
+			bool any = false;
+			for (int s = 0; s < CHUNK_SECTIONS; s++)
+				any = any or (current & (1u << s) and not result.Data[s].Vertices.empty());
+
+			// sections missing from a chunk without a mesh were empty
+			if (any and not rc.Mesh) {
+				rc.Mesh.reset(new ChunkMesh());
+				rc.Mesh->Model = Chunk::ModelMatrixAt(cx, cy, cz);
+			}
+			if (rc.Mesh)
+				rc.Mesh->Upload(current, result.Data);
+			// nothing to draw, so don't hold on to any GL objects either
+			if (rc.Mesh and rc.Mesh->VertexCount == 0)
+				rc.Mesh.reset();
+		}
+
+		// bounds may have moved even if the chunk stays in the list
+		if (hadDrawable or rc.Mesh or rc.Instances)
+			listDirty = true;
+		return true;
+	}
+
+	// Breadth first search from the camera's chunk through faces that see
+	// each other, never stepping back against a direction already taken and
+	// never leaving the frustum. Clears visible[] for chunks it doesn't
+	// reach. Returns false, culling nothing, if the camera's chunk isn't loaded.
+	bool occlusionCull(const Frustum &frustum, glm::vec3 cameraPosition) {
+		PROFILE_ZONE("occlusion cull");
+		static const int offsets[6][3] = {
+			{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+		};
+
+		glm::vec3 p = Chunk::BlockPosition(cameraPosition) / (float)CHUNK_SIZE;
+		int sx = floorf(p.x), sy = floorf(p.y), sz = floorf(p.z);
+		RenderChunk *start = Chunks.Find(pack_chunk_coord(sx, sy, sz));
+		if (not start)
+			return false;
+
+		struct Step {
+			int X, Y, Z;
+			RenderChunk *RC;
+			int From;		// face we came in through, -1 for the start
+			int Directions;	// bit per face direction taken so far
+		};
+
+		frame++;
+		std::vector<uint8_t> reached(drawList.size(), 0);
+		std::deque<Step> queue;
+		start->Visited = frame;
+		queue.push_back({ sx, sy, sz, start, -1, 0 });
+
+		while (not queue.empty()) {
+			Step s = queue.front();
+			queue.pop_front();
+			if (s.RC->ListIndex >= 0)
+				reached[s.RC->ListIndex] = 1;
+
+			for (int face = 0; face < 6; face++) {
+				int opposite = face ^ 1;
+				if (s.Directions & (1 << opposite))
+					continue;
+				if (s.From >= 0 and not faces_connected(s.RC->Connectivity, s.From, face))
+					continue;
+
+				int nx = s.X + offsets[face][0], ny = s.Y + offsets[face][1], nz = s.Z + offsets[face][2];
+				RenderChunk *n = Chunks.Find(pack_chunk_coord(nx, ny, nz));
+				if (not n or n->Visited == frame)
+					continue;
+
+				glm::mat4 model = Chunk::ModelMatrixAt(nx, ny, nz);
+				glm::vec4 a = model * glm::vec4(0, 0, 0, 1), b = model * glm::vec4(glm::vec3(CHUNK_SIZE), 1);
+				glm::vec3 center = (glm::vec3(a.x, a.y, a.z) + glm::vec3(b.x, b.y, b.z)) * 0.5f;
+				if (not frustum.Intersects(center, glm::vec3(CHUNK_SIZE * 0.5f)))
+					continue;
+
+				n->Visited = frame;
+				queue.push_back({ nx, ny, nz, n, opposite, s.Directions | (1 << face) });
+			}
+		}
+
+		reachedCount = 0;
+		for (size_t i = 0; i < visible.size(); i++) {
+			visible[i] = visible[i] and reached[i];
+			reachedCount += visible[i];
+		}
+		return true;
+	}
+};
+
+#endif
@@ -7,21 +7,35 @@
 
 #include "lib/camera.h"
 #include "lib/shader.h"
-#include "lib/image.h"
+#include "lib/blocktextures.h"
+#include "lib/blockcolors.h"
+#include "lib/camerauniforms.h"
 #include "lib/chunk.h"
-#include "lib/cube.h"
+#include "lib/world.h"
+#include "lib/worldgen.h"
+#include "lib/worldrenderer.h"
+#include "lib/profiler.h"
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
 #include <vector>
 
 const int WIN_WIDTH = 1000, WIN_HEIGHT = 1000;
 
+const uint32_t WORLD_SEED = 1337;
+// chunks generated around the camera, horizontally, and the layers of
+// chunks the ground lies in
+const int WORLD_RADIUS = 4;
+const int WORLD_BOTTOM = -1, WORLD_TOP = 1;
+
 void framebuffer_size_callback(GLFWwindow *window, int w, int h);
 bool pressed(GLFWwindow* window, GLenum key);
 void processInput(GLFWwindow* window);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void request_chunks(WorldGenerator &generator, glm::vec3 cameraPosition);
 
 const glm::mat4 unit = glm::mat4(1.0f);
 
@@ -32,8 +46,16 @@ float lastFrame = 0.0f;
 float lastX, lastY;
 bool firstMouse = true;
 
+MeshMode meshMode = MESH_GREEDY;
+bool occlusionCulling = true;
+RenderPath renderPath = RENDER_MESHES;
+
+// where P (and quitting, in profiling builds) writes the profile
+const char *TRACE_PATH = "trace.json";
+
 int main() {
-	
+	PROFILE_THREAD("main");
+
 	// glfw setup
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -62,137 +84,124 @@ int main() {
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	glfwSetCursorPosCallback(window, mouse_callback);
 	glfwSetScrollCallback(window, scroll_callback);
+	glfwSetKeyCallback(window, key_callback);
 
 	// =============================================
 	
-	Texture dirt(GL_TEXTURE0, "textures/dirt.jpg");
-	Texture smiley(GL_TEXTURE1, "textures/awesomeface.png", GL_RGBA);
-	
-	float vertices[] = {
-		-0.5, 0.5, 0.5,0.0, 1.0,
-		0.5, 0.5, 0.5,1.0, 1.0,
-		0.5,-0.5, 0.5,1.0, 0.0,
-		0.5,-0.5, 0.5,1.0, 0.0,
-		-0.5,-0.5, 0.5,0.0, 0.0,
-		-0.5, 0.5, 0.5,0.0, 1.0,
-		0.5, 0.5,-0.5,0.0, 1.0,
-		-0.5, 0.5,-0.5,1.0, 1.0,
-		-0.5,-0.5,-0.5,1.0, 0.0,
-		-0.5,-0.5,-0.5,1.0, 0.0,
-		0.5,-0.5,-0.5,0.0, 0.0,
-		0.5, 0.5,-0.5,0.0, 1.0,
-		-0.5, 0.5,-0.5,0.0, 1.0,
-		-0.5, 0.5, 0.5,1.0, 1.0,
-		-0.5,-0.5, 0.5,1.0, 0.0,
-		-0.5,-0.5, 0.5,1.0, 0.0,
-		-0.5,-0.5,-0.5,0.0, 0.0,
-		-0.5, 0.5,-0.5,0.0, 1.0,
-		0.5, 0.5, 0.5,0.0, 1.0,
-		0.5, 0.5,-0.5,1.0, 1.0,
-		0.5,-0.5,-0.5,1.0, 0.0,
-		0.5,-0.5,-0.5,1.0, 0.0,
-		0.5,-0.5, 0.5,0.0, 0.0,
-		0.5, 0.5, 0.5,0.0, 1.0,
-		-0.5, 0.5,-0.5,0.0, 1.0,
-		0.5, 0.5,-0.5,1.0, 1.0,
-		0.5, 0.5, 0.5,1.0, 0.0,
-		0.5, 0.5, 0.5,1.0, 0.0,
-		-0.5, 0.5, 0.5,0.0, 0.0,
-		-0.5, 0.5,-0.5,0.0, 1.0,
-		0.5,-0.5,-0.5,0.0, 1.0,
-		-0.5,-0.5,-0.5,1.0, 1.0,
-		-0.5,-0.5, 0.5,1.0, 0.0,
-		-0.5,-0.5, 0.5,1.0, 0.0,
-		0.5,-0.5, 0.5,0.0, 0.0,
-		0.5,-0.5,-0.5,0.0, 1.0,
-	};
-
-
-	unsigned int VAO;
-	glGenVertexArrays(1, &VAO);
-	glBindVertexArray(VAO);
-
-	unsigned int VBO;
-	glGenBuffers(1, &VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *) 0);
-	glEnableVertexAttribArray(0);
-
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	BlockTextures blockTextures(block_registry());
+	blockTextures.bind(GL_TEXTURE0);
+
+	BlockColors blockColors(block_registry(), blockTextures.Layers);
+	blockColors.bind(GL_TEXTURE1);
 
 	Shader shader("shader/shader.vert", "shader/shader.frag");
 	shader.use();
+	shader.setInt("blockTextures", 0);
+	shader.setInt("blockColors", 1);
 
-	shader.setInt("dirt", 0);
-	shader.setInt("awesome", 1);
+	Shader instancedShader("shader/instanced.vert", "shader/shader.frag");
+	instancedShader.use();
+	instancedShader.setInt("blockTextures", 0);
 
-	glm::mat4 view = camera.GetViewMatrix();
-	glm::mat4 projection;
-	projection = glm::perspective(glm::radians(camera.Fov), (float)WIN_HEIGHT/(float)WIN_HEIGHT, 0.1f, 100.0f);
+	CameraUniforms cameraUniforms;
+	cameraUniforms.Attach(shader);
+	cameraUniforms.Attach(instancedShader);
 
-	shader.setMat4("view", view);
-	shader.setMat4("projection", projection);
+	glm::mat4 view, projection;
 
-	int height[16][16];
-	for (int i = 0; i < 16; i++) {
-		for (int j = 0; j < 16; j++) {
-			height[i][j] = 15 - abs(8-i) - abs(8-j);
-		}
-	}
+	World world;
+	// generating and meshing share the workers so they don't fight over cores
+	ThreadPool workers;
+	WorldGenerator generator(WORLD_SEED, workers);
 
-	/* Chunk chunk; */
-	Chunk chunk(height);
+	WorldRenderer renderer(workers);
+
+	int frames = 0;
+	float lastStats = 0.0f;
 
 	// loop
 	while (!glfwWindowShouldClose(window)) {
+		PROFILE_ZONE("frame");
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
-		processInput(window);
+		{
+			PROFILE_ZONE("input");
+			processInput(window);
+			glfwPollEvents();
+		}
 
 		glClearColor(0.2f, 0.3f, 0.6f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		shader.use();
+		Shader &active = renderPath == RENDER_INSTANCED ? instancedShader : shader;
+		active.use();
 
 		projection = glm::perspective(glm::radians(camera.Fov), (float)WIN_WIDTH/(float)WIN_HEIGHT, 0.1f, 100.0f);
-		shader.setMat4("projection", projection);
-
 		view = camera.GetViewMatrix();
-		shader.setMat4("view", view);
-
-		glBindVertexArray(VAO);
-		for (int i = 0; i < 16; i++) {
-			for (int j = 0; j < 16; j++) {
-				for (int k = 0; k < 16; k++) {
-					Cube cube = chunk.cubes[i][j][k];
-					glm::mat4 model = glm::translate(unit, cube.Position);
-
-					shader.setMat4("model", model);
-					shader.setVec3("aColor", cube.B.Color);
-
-					if (not cube.IsAir())
-						glDrawArrays(GL_TRIANGLES, 0, 36);
-				}
-			}
+		cameraUniforms.Update(view, projection);
+
+		request_chunks(generator, camera.Position);
+		generator.Update(world);
+		if (generator.ChunksFinished > 0) {
+			print_message("generated " + std::to_string(generator.ChunksFinished) + " chunks, "
+					+ std::to_string(generator.Pending()) + " pending");
+		}
+
+		if (renderer.Update(world, meshMode, renderPath)) {
+			print_message("uploaded " + std::to_string(renderer.ChunksMeshed) + " chunks ("
+					+ (renderPath == RENDER_INSTANCED ? "instanced" : (std::string)mesh_mode_name(meshMode)) + "): "
+					+ std::to_string(renderer.VerticesMeshed) + " vertices meshed in "
+					+ std::to_string(renderer.MeshMicroseconds) + "us, "
+					+ std::to_string(renderer.Pending) + " pending");
+		}
+		renderer.OcclusionCulling = occlusionCulling;
+		renderer.Draw(active, projection * view, camera.Position);
+
+		frames++;
+		if (currentFrame - lastStats >= 1.0f) {
+			FrameStats &stats = renderer.Stats;
+			std::string title = "duducraft | " + std::to_string(frames) + " fps | "
+				+ std::to_string(stats.DrawCalls) + "/" + std::to_string(stats.Chunks) + " chunks drawn, "
+				+ std::to_string(stats.FrustumCulled) + " frustum culled, "
+				+ std::to_string(stats.OcclusionCulled) + " occlusion culled | "
+				+ std::to_string(stats.Triangles) + " triangles";
+			glfwSetWindowTitle(window, title.c_str());
+			frames = 0;
+			lastStats = currentFrame;
 		}
-		glBindVertexArray(0);
 
+		PROFILE_ZONE("swap");
 		glfwSwapBuffers(window);
-		glfwPollEvents();
 	}
 
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-
+	if (PROFILING)
+		profiler_write_trace(TRACE_PATH);
 	glfwTerminate();
 	return 0;
 }
 
+// Asks for every chunk within WORLD_RADIUS of the camera, nearest first;
+// the ones already asked for cost a lookup
+void request_chunks(WorldGenerator &generator, glm::vec3 cameraPosition) {
+	static std::vector<glm::ivec2> offsets;
+	if (offsets.empty()) {
+		for (int dx = -WORLD_RADIUS; dx <= WORLD_RADIUS; dx++)
+			for (int dz = -WORLD_RADIUS; dz <= WORLD_RADIUS; dz++)
+				offsets.push_back(glm::ivec2(dx, dz));
+		std::sort(offsets.begin(), offsets.end(), [](glm::ivec2 a, glm::ivec2 b) {
+			return a.x * a.x + a.y * a.y < b.x * b.x + b.y * b.y;
+		});
+	}
+
+	glm::vec3 p = Chunk::BlockPosition(cameraPosition) / (float)CHUNK_SIZE;
+	int cx = floorf(p.x), cz = floorf(p.z);
+	for (glm::ivec2 offset : offsets)
+		for (int cy = WORLD_TOP; cy >= WORLD_BOTTOM; cy--)
+			generator.Request(cx + offset.x, cy, cz + offset.y);
+}
+
 void framebuffer_size_callback(GLFWwindow *window, int w, int h) {
 	glViewport(0, 0, w, h);
 	std::cout << "Window resized to " << w << " " << h << std::endl;
@@ -247,3 +256,14 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
 	camera.ProcessMouseScroll(yoffset);
 }
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	if (key == GLFW_KEY_G and action == GLFW_PRESS)
+		meshMode = (MeshMode)((meshMode + 1) % MESH_MODE_COUNT);
+	if (key == GLFW_KEY_C and action == GLFW_PRESS)
+		occlusionCulling = not occlusionCulling;
+	if (key == GLFW_KEY_I and action == GLFW_PRESS)
+		renderPath = renderPath == RENDER_MESHES ? RENDER_INSTANCED : RENDER_MESHES;
+	if (key == GLFW_KEY_P and action == GLFW_PRESS)
+		profiler_write_trace(TRACE_PATH);
+}
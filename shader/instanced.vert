@@ -0,0 +1,27 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+
+// per instance
+layout (location = 2) in vec3 iPosition;
+layout (location = 3) in vec3 iColor;
+
+out vec2 TexCoord;
+out vec3 blockColor;
+// untextured, instances only carry a color
+flat out int layer;
+
+uniform mat4 model;
+
+layout (std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+};
+
+void main() {
+	gl_Position = projection * view * model * vec4(aPos + iPosition, 1.0);
+	TexCoord = aTexCoord;
+	blockColor = iColor;
+	layer = 0;
+}
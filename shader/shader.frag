@@ -2,11 +2,10 @@
 
 in vec2 TexCoord;
 in vec3 blockColor;
+flat in int layer;
 
-uniform sampler2D dirt;
-uniform sampler2D awesome;
+uniform sampler2DArray blockTextures;
 
 void main() {
-	gl_FragColor = vec4(blockColor, 1.0f);
-//	gl_FragColor = texture(awesome, TexCoord);
+	gl_FragColor = vec4(blockColor * texture(blockTextures, vec3(TexCoord, layer)).rgb, 1.0f);
 }
@@ -1,19 +1,35 @@
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoord;
-
-uniform vec3 aColor;
+// packed ChunkVertex, see lib/mesher.h
+layout (location = 0) in uvec2 aData;
 
 out vec2 TexCoord;
 out vec3 blockColor;
+flat out int layer;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+layout (std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+};
+
+uniform samplerBuffer blockColors;
 
 void main() {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
-	TexCoord = aTexCoord;
-	blockColor = aColor;
+	uint d0 = aData.x, d1 = aData.y;
+
+	vec3 pos = vec3(d0 & 63u, (d0 >> 6) & 63u, (d0 >> 12) & 63u);
+	uint face = (d0 >> 18) & 7u;
+	float ao = float((d0 >> 21) & 3u) / 3.0;
+	int block = int(d1 & 0xffffu);
+	vec2 uv = vec2((d1 >> 16) & 63u, (d1 >> 22) & 63u);
+
+	gl_Position = projection * view * model * vec4(pos, 1.0);
+	// x faces run u along y, turn them so the texture stands up like on z faces
+	TexCoord = face < 2u ? uv.yx : uv;
+
+	vec4 color = texelFetch(blockColors, block);
+	blockColor = color.rgb * mix(0.5, 1.0, ao);
+	layer = int(color.a);
 }